@@ -8,6 +8,7 @@
  */
 
 #include "Engine/Components/Async.hpp"
+#include "Engine/Components/Fonts.hpp"
 #include "Engine/Core/ONScripter.hpp"
 #include "Engine/Core/Parser.hpp"
 #include "Engine/Media/Controller.hpp"
@@ -45,7 +46,8 @@ AsyncController::AsyncController()
                       {"loadAudioFramesQueue", false},
                       {"loadSubtitleFramesQueue", false}},
       playSoundQueue("playSoundQueue", false),
-      eventQueueQueue("eventQueueQueue", false, false /*needs no instructions*/) {
+      eventQueueQueue("eventQueueQueue", false, false /*needs no instructions*/),
+      prerenderGlyphsQueue("prerenderGlyphsQueue") {
 	imageCacheQueue.threadLoopFunction                                  = imageCacheThreadLoop;
 	soundCacheQueue.threadLoopFunction                                  = soundCacheThreadLoop;
 	loadImageQueue.threadLoopFunction                                   = loadImageThreadLoop;
@@ -55,6 +57,7 @@ AsyncController::AsyncController()
 	loadFramesQueue[MediaProcController::SubsEntry].threadLoopFunction  = loadSubtitleFramesThreadLoop;
 	playSoundQueue.threadLoopFunction                                   = playSoundThreadLoop;
 	eventQueueQueue.threadLoopFunction                                  = eventQueueThreadLoop;
+	prerenderGlyphsQueue.threadLoopFunction                             = prerenderGlyphsThreadLoop;
 
 	queueCollection.push_back(&imageCacheQueue);
 	queueCollection.push_back(&soundCacheQueue);
@@ -65,6 +68,7 @@ AsyncController::AsyncController()
 	queueCollection.push_back(&loadPacketArraysQueue);
 	queueCollection.push_back(&playSoundQueue);
 	queueCollection.push_back(&eventQueueQueue);
+	queueCollection.push_back(&prerenderGlyphsQueue);
 }
 
 void AsyncController::endThreads() {
@@ -427,3 +431,22 @@ int eventQueueThreadLoop(void *arg) {
 	AsyncController *ac = static_cast<AsyncController *>(arg);
 	return ac->asyncLoop(ac->eventQueueQueue);
 }
+
+/* -------------- Prerender glyphs instruction -------------- */
+
+void PrerenderGlyphsInstruction::execute() {
+	fonts.prerenderGlyphs(key, preset_id, codepoints, generation);
+}
+
+AsyncInstructionQueue *PrerenderGlyphsInstruction::getInstructionQueue() {
+	return &ac->prerenderGlyphsQueue;
+}
+
+void AsyncController::prerenderGlyphs(const GlyphParams &key, int preset_id, std::vector<uint32_t> codepoints) {
+	queue(std::make_unique<PrerenderGlyphsInstruction>(this, key, preset_id, std::move(codepoints), fonts.currentPrerenderGeneration()));
+}
+
+int prerenderGlyphsThreadLoop(void *arg) {
+	AsyncController *ac = static_cast<AsyncController *>(arg);
+	return ac->asyncLoop(ac->prerenderGlyphsQueue);
+}
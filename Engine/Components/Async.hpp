@@ -11,6 +11,7 @@
 
 #include "External/Compatibility.hpp"
 #include "Engine/Components/Base.hpp"
+#include "Engine/Entities/Glyph.hpp"
 
 #include <SDL2/SDL_thread.h>
 
@@ -21,6 +22,7 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 class AsyncInstruction;
 class AsyncInstructionQueue;
@@ -159,6 +161,18 @@ public:
 	    : AsyncInstruction(_ac) {}
 };
 
+class PrerenderGlyphsInstruction : public AsyncInstruction {
+public:
+	AsyncInstructionQueue *getInstructionQueue() override;
+	GlyphParams key;
+	int preset_id;
+	std::vector<uint32_t> codepoints;
+	uint32_t generation;
+	void execute() override;
+	PrerenderGlyphsInstruction(AsyncController *_ac, const GlyphParams &_key, int _preset_id, std::vector<uint32_t> _codepoints, uint32_t _generation)
+	    : AsyncInstruction(_ac), key(_key), preset_id(_preset_id), codepoints(std::move(_codepoints)), generation(_generation) {}
+};
+
 class VirtualMutexes {
 public:
 	void setMutex(void *ptr);
@@ -186,6 +200,7 @@ int loadAudioFramesThreadLoop(void *arg);
 int loadSubtitleFramesThreadLoop(void *arg);
 int playSoundThreadLoop(void *arg);
 int eventQueueThreadLoop(void *arg);
+int prerenderGlyphsThreadLoop(void *arg);
 
 class AsyncController : public BaseController {
 protected:
@@ -195,7 +210,7 @@ protected:
 public:
 	AsyncInstructionQueue imageCacheQueue, soundCacheQueue,
 	    loadImageQueue, loadPacketArraysQueue, loadFramesQueue[3],
-	    playSoundQueue, eventQueueQueue;
+	    playSoundQueue, eventQueueQueue, prerenderGlyphsQueue;
 	std::vector<AsyncInstructionQueue *> queueCollection;
 	VirtualMutexes mutexes; //-V730_NOINIT
 	bool threadShutdownRequested{false};
@@ -213,6 +228,7 @@ public:
 	void loadSubtitleFrames(SubtitleLayer *sl);
 	void playSound(const char *filename, int format, bool loop_flag, int channel);
 	void startEventQueue();
+	void prerenderGlyphs(const GlyphParams &key, int preset_id, std::vector<uint32_t> codepoints);
 
 	void queue(std::unique_ptr<AsyncInstruction> inst);
 
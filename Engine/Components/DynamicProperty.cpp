@@ -420,6 +420,7 @@ void DynamicPropertyController::DynamicSpriteProperty::setValue(double value) {
 			case SPRITE_PROPERTY_Z_ORDER:
 				curAi->has_z_order_override = true;
 				curAi->z_order_override     = value;
+				ons.invalidateZOrder();
 				//sendToLog(LogLevel::Info, "order %d (%d)\n", curAi->id, value);
 				break;
 			default: // LSP2 properties:
@@ -8,14 +8,44 @@
  */
 
 #include "Engine/Components/Fonts.hpp"
+#include "Engine/Components/Async.hpp"
 #include "Engine/Readers/Base.hpp"
 #include "Engine/Core/ONScripter.hpp"
 #include "Support/FileIO.hpp"
+#include "Support/Parallel.hpp"
 
+#include <algorithm>
 #include <sstream>
 
 FontsController fonts;
 
+FT_Error FontsController::openFace(FT_Library library, const char *path, FT_Long index, FT_Face *face) {
+	size_t size{0};
+	FILE *fp = FileIO::accessFile(path, FileType::File, &size) ? FileIO::openFile(path, "rb") : nullptr;
+
+	if (!fp)
+		return FT_Err_Cannot_Open_Resource;
+
+	auto stream                = new FT_StreamRec{};
+	stream->descriptor.pointer = fp;
+	stream->size               = size;
+	stream->read               = [](FT_Stream stream, unsigned long offset, unsigned char *buffer, unsigned long count) -> unsigned long {
+		auto fp = static_cast<FILE *>(stream->descriptor.pointer);
+		FileIO::seekFile(fp, offset, SEEK_SET);
+		return std::fread(buffer, sizeof(uint8_t), count, fp);
+	};
+	stream->close = [](FT_Stream stream) -> void {
+		std::fclose(static_cast<FILE *>(stream->descriptor.pointer));
+		delete stream;
+	};
+
+	FT_Open_Args args{};
+	args.flags  = FT_OPEN_STREAM;
+	args.stream = stream;
+
+	return FT_Open_Face(library, &args, index, face);
+}
+
 bool FontsController::loadFont(Font &f, size_t i, bool user) {
 	char *dir = user ? userfontdir : fontdir;
 	if (dir[0] == '\0') {
@@ -31,7 +61,6 @@ bool FontsController::loadFont(Font &f, size_t i, bool user) {
 
 	const char *extensions[]{".ttf", ".otf"};
 	bool found{false};
-	size_t size{0};
 
 	for (auto &ext : extensions) {
 		char tmp[32]{};
@@ -41,7 +70,7 @@ bool FontsController::loadFont(Font &f, size_t i, bool user) {
 		else
 			std::snprintf(tmp, sizeof(tmp), "font%zu%s", i, ext);
 
-		if (FileIO::accessFile(tmp, dir, FileType::File, &size)) {
+		if (FileIO::accessFile(tmp, dir, FileType::File)) {
 			size_t len = std::strlen(dir) + std::strlen(tmp) + 1;
 			f.path = std::make_unique<char[]>(len);
 			std::snprintf(f.path.get(), len, "%s%s", dir, tmp);
@@ -52,29 +81,7 @@ bool FontsController::loadFont(Font &f, size_t i, bool user) {
 	if (!found)
 		return false;
 
-	FILE *fp = FileIO::openFile(f.path.get(), "rb");
-
-	if (!fp)
-		return false;
-
-	auto stream                = new FT_StreamRec{};
-	stream->descriptor.pointer = fp;
-	stream->size               = size;
-	stream->read               = [](FT_Stream stream, unsigned long offset, unsigned char *buffer, unsigned long count) -> unsigned long {
-		auto fp = static_cast<FILE *>(stream->descriptor.pointer);
-		FileIO::seekFile(fp, offset, SEEK_SET);
-		return std::fread(buffer, sizeof(uint8_t), count, fp);
-	};
-	stream->close = [](FT_Stream stream) -> void {
-		std::fclose(static_cast<FILE *>(stream->descriptor.pointer));
-		delete stream;
-	};
-
-	FT_Open_Args args{};
-	args.flags  = FT_OPEN_STREAM;
-	args.stream = stream;
-
-	if (FT_Open_Face(freetype, &args, 0, &f.normal_face))
+	if (openFace(freetype, f.path.get(), 0, &f.normal_face))
 		return false;
 
 	//Set normal_face as current face
@@ -278,7 +285,92 @@ void FontsController::initFontMultiplier(const std::string &m) {
 	}
 }
 
+void FontsController::prerenderGlyphs(const GlyphParams &key, int preset_id, const std::vector<uint32_t> &codepoints, uint32_t generation) {
+	auto stale = [this, generation]() {
+		return prerenderCancelled.load(std::memory_order_relaxed) || async.threadShutdownRequested ||
+		       prerenderGeneration.load(std::memory_order_relaxed) != generation;
+	};
+
+	Font &orig = getFont(key.font_number, preset_id);
+	if (stale() || !orig.loaded || !orig.ownsStyle(key.is_bold, key.is_italic))
+		return;
+
+	// FreeType libraries and faces are not thread-safe, every job opens the font on its own and rasterises a slice
+	size_t slices = std::min(std::max<size_t>(parallelThreadCount() - 1, 1), codepoints.size());
+	runParallel(slices, [this, &key, preset_id, &codepoints, &orig, generation, &stale, slices](size_t slice) {
+		FT_Library library;
+		if (FT_Init_FreeType(&library))
+			return;
+
+		Font font;
+		if (font.openCopy(library, orig) && font.ownsStyle(key.is_bold, key.is_italic)) {
+			static SDL_Color fcol = {0xff, 0xff, 0xff, 0xff}, bcol = {0, 0, 0, 0};
+			font.setStyle(key.is_bold, key.is_italic);
+			font.setSize(key.font_size, key.font_number, preset_id);
+			font.setBorder(key.border_width);
+
+			size_t end = codepoints.size() * (slice + 1) / slices;
+			for (size_t i = codepoints.size() * slice / slices; i < end && !stale(); i++) {
+				GlyphParams glyphKey = key;
+				glyphKey.unicode     = codepoints[i];
+
+				SDL_AtomicLock(&prerenderedGlyphsLock);
+				bool known = prerenderedGlyphs.count(glyphKey);
+				SDL_AtomicUnlock(&prerenderedGlyphsLock);
+				if (known)
+					continue;
+
+				auto glyph = font.renderGlyph(&glyphKey, fcol, bcol);
+				// Glyphs of dropped presets would never be taken, the generation is rechecked under the lock
+				SDL_AtomicLock(&prerenderedGlyphsLock);
+				if (prerenderGeneration.load(std::memory_order_relaxed) == generation && !prerenderedGlyphs.count(glyphKey)) {
+					prerenderedGlyphs[glyphKey] = glyph;
+					glyph                       = nullptr;
+				}
+				SDL_AtomicUnlock(&prerenderedGlyphsLock);
+				delete glyph;
+			}
+		}
+
+		// Also closes the copied faces
+		FT_Done_FreeType(library);
+	}, "GlyphPrerender");
+}
+
+GlyphValues *FontsController::takePrerenderedGlyph(const GlyphParams &key) {
+	GlyphValues *glyph{nullptr};
+	SDL_AtomicLock(&prerenderedGlyphsLock);
+	auto it = prerenderedGlyphs.find(key);
+	if (it != prerenderedGlyphs.end()) {
+		glyph = it->second;
+		prerenderedGlyphs.erase(it);
+	}
+	SDL_AtomicUnlock(&prerenderedGlyphsLock);
+	return glyph;
+}
+
+void FontsController::dropPrerenderedGlyphs() {
+	SDL_AtomicLock(&prerenderedGlyphsLock);
+	prerenderGeneration.fetch_add(1, std::memory_order_relaxed);
+	for (auto &glyph : prerenderedGlyphs) delete glyph.second;
+	prerenderedGlyphs.clear();
+	SDL_AtomicUnlock(&prerenderedGlyphsLock);
+}
+
 int FontsController::ownDeinit() {
+	// Async is deinitialised after us, so stop the rasterisation thread here before freeing the fonts
+	prerenderCancelled.store(true, std::memory_order_relaxed);
+	while (true) {
+		SDL_AtomicLock(&async.prerenderGlyphsQueue.lock);
+		bool running = async.prerenderGlyphsQueue.thread;
+		SDL_AtomicUnlock(&async.prerenderGlyphsQueue.lock);
+		if (!running)
+			break;
+		SDL_Delay(1);
+	}
+
+	dropPrerenderedGlyphs();
+
 	if (fonts_number > 0)
 		FT_Done_FreeType(freetype);
 	return 0;
@@ -11,6 +11,7 @@
 
 #include "External/Compatibility.hpp"
 #include "Engine/Components/Base.hpp"
+#include "Engine/Entities/Glyph.hpp"
 
 #include <SDL2/SDL.h>
 #include <ft2build.h>
@@ -20,12 +21,12 @@
 #include FT_STROKER_H
 #include FT_TRUETYPE_IDS_H
 
+#include <atomic>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
-struct GlyphParams;
 class BaseReader;
-class GlyphValues;
 
 class Font {
 private:
@@ -67,9 +68,23 @@ public:
 
 	FT_Error err{0};
 
+	// Opens the typefaces of a loaded font in another FreeType library, aliased styles are not copied
+	bool openCopy(FT_Library library, const Font &orig);
+	bool ownsStyle(bool bold, bool italic) const {
+		if (bold && italic)
+			return hasInternalBoldItalicFace;
+		if (bold)
+			return hasInternalBoldFace;
+		if (italic)
+			return hasInternalItalicFace;
+		return true;
+	}
+
 	SDL_Surface *freetypeToSDLSurface(FT_Bitmap *ft_bmp, SDL_Color fg, SDL_Color bg);
 	GlyphValues *renderGlyph(GlyphParams *key, SDL_Color fg, SDL_Color bg);
 	GlyphValues *measureGlyph(GlyphParams *key);
+	// Renders a signed distance field of the glyph at GlyphDistanceFieldSize, colours and borders are left to the shader
+	GlyphValues *renderDistanceField(GlyphParams *key);
 
 	FT_GlyphSlot loadGlyph(uint32_t unicode, unsigned int &charIndex) {
 		charIndex = FT_Get_Char_Index(face, unicode);
@@ -80,6 +95,9 @@ public:
 	}
 
 	void setSize(int val, unsigned int id, int preset_id);
+	int size() const {
+		return current_size;
+	}
 	void setBorder(int val) {
 		border_width = val;
 	} // in 1/64ths
@@ -107,6 +125,13 @@ public:
 class FontsController : public BaseController {
 	BaseReader **reader{nullptr};
 
+	// Glyphs rasterised in the background, keyed like uncoloured glyphCache entries
+	std::unordered_map<GlyphParams, GlyphValues *, GlyphParamsHash, GlyphParamsEqual> prerenderedGlyphs;
+	SDL_SpinLock prerenderedGlyphsLock{0};
+	std::atomic<bool> prerenderCancelled{false};
+	// Bumped by dropPrerenderedGlyphs, jobs queued before that discard their results
+	std::atomic<uint32_t> prerenderGeneration{0};
+
 public:
 	FT_Library freetype{}; //normally private
 	size_t fonts_number{0};
@@ -120,7 +145,14 @@ public:
 	std::unordered_map<unsigned int, float> baseSizeMultipliers;
 	std::unordered_map<unsigned int, std::unordered_map<unsigned int, float>> presetSizeMultipliers;
 
+	FT_Error openFace(FT_Library library, const char *path, FT_Long index, FT_Face *face);
 	bool loadFont(Font &f, size_t i, bool user);
+	void prerenderGlyphs(const GlyphParams &key, int preset_id, const std::vector<uint32_t> &codepoints, uint32_t generation);
+	uint32_t currentPrerenderGeneration() const {
+		return prerenderGeneration.load(std::memory_order_relaxed);
+	}
+	GlyphValues *takePrerenderedGlyph(const GlyphParams &key);
+	void dropPrerenderedGlyphs();
 	void initFontOverrides(const std::string &o);
 	void initFontMultiplier(const std::string &m);
 	Font &getFont(unsigned int id, int preset_id = -1);
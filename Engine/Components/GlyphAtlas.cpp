@@ -61,30 +61,59 @@ SDL_Rect *GlyphAtlasNode::insert(int w, int h) {
 }
 
 int GlyphAtlasController::ownInit() {
-	atlas = gpu.createImage(width, height, 4);
-	GPU_GetTarget(atlas);
+	for (auto &page : pages) {
+		page.image = gpu.createImage(width, height, 4);
+		GPU_GetTarget(page.image);
+	}
 	return 0;
 }
 
 int GlyphAtlasController::ownDeinit() {
-	if (atlas)
-		gpu.freeImage(atlas);
+	for (auto &page : pages) {
+		if (page.image)
+			gpu.freeImage(page.image);
+		page.image = nullptr;
+	}
 	return 0;
 }
 
-bool GlyphAtlasController::add(int w, int h, GPU_Rect &pos) {
-	auto rect = root.insert(w, h);
-	if (!rect) {
-		return false;
+bool GlyphAtlasController::add(int w, int h, GPU_Rect &pos, uint32_t &page) {
+	for (uint32_t i = 0; i < pages.size(); i++) {
+		auto rect = pages[i].root.insert(w, h);
+		if (!rect)
+			continue;
+		pos.x          = rect->x;
+		pos.y          = rect->y;
+		pos.w          = rect->w;
+		pos.h          = rect->h;
+		page           = i;
+		pages[i].empty = false;
+		touch(i);
+		return true;
 	}
-	pos.x = rect->x;
-	pos.y = rect->y;
-	pos.w = rect->w;
-	pos.h = rect->h;
+	return false;
+}
+
+bool GlyphAtlasController::evict(uint32_t &page) {
+	Page *victim{nullptr};
+	for (auto &p : pages) {
+		if (!p.empty && (!victim || p.lastUse < victim->lastUse))
+			victim = &p;
+	}
+	if (!victim)
+		return false;
+
+	page = static_cast<uint32_t>(victim - pages.data());
+	victim->root.reset(width, height);
+	victim->empty = true;
+	gpu.clearWholeTarget(victim->image->target);
 	return true;
 }
 
 void GlyphAtlasController::reset() {
-	root.reset(width, height);
-	gpu.clearWholeTarget(atlas->target);
+	for (auto &page : pages) {
+		page.root.reset(width, height);
+		page.empty = true;
+		gpu.clearWholeTarget(page.image->target);
+	}
 }
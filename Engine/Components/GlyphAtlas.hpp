@@ -16,11 +16,14 @@
 #include <SDL2/SDL_gpu.h>
 
 #include <memory>
+#include <vector>
+#include <cstdint>
 
-// double 4096 is a bit too much for iOS
-const int NUM_GLYPH_CACHE = 2048;
-const int GLYPH_ATLAS_W   = 2048;
-const int GLYPH_ATLAS_H   = 4096;
+// double 4096 is a bit too much for iOS, so the same memory is split in pages evicted one at a time
+const int NUM_GLYPH_CACHE   = 2048;
+const int GLYPH_ATLAS_W     = 2048;
+const int GLYPH_ATLAS_H     = 1024;
+const int GLYPH_ATLAS_PAGES = 4;
 
 class GlyphAtlasNode {
 	std::unique_ptr<GlyphAtlasNode> left, right;
@@ -33,21 +36,43 @@ public:
 };
 
 class GlyphAtlasController : public BaseController {
-	GlyphAtlasNode root;
+	struct Page {
+		GlyphAtlasNode root;
+		GPU_Image *image{nullptr};
+		uint64_t lastUse{0};
+		bool empty{true};
+	};
+
+	std::vector<Page> pages;
 	int width, height;
+	uint64_t useCounter{0};
 
 protected:
 	int ownInit() override;
 	int ownDeinit() override;
 
 public:
-	GlyphAtlasController(int w, int h)
-	    : BaseController(this), width(w), height(h) {
-		root.reset(width, height);
+	GlyphAtlasController(int w, int h, int count)
+	    : BaseController(this), pages(count), width(w), height(h) {
+		for (auto &page : pages) page.root.reset(width, height);
 	}
 
-	bool add(int w, int h, GPU_Rect &pos);
+	bool add(int w, int h, GPU_Rect &pos, uint32_t &page);
+	// Clears the least recently used page with glyphs and returns its number, false when all pages are empty
+	bool evict(uint32_t &page);
 	void reset();
 
-	GPU_Image *atlas{nullptr};
+	// Whether a w x h rectangle fits an empty page, larger ones can never be added
+	bool fits(int w, int h) const {
+		return w <= width && h <= height;
+	}
+	void touch(uint32_t page) {
+		pages[page].lastUse = ++useCounter;
+	}
+	GPU_Image *image(uint32_t page) {
+		return pages[page].image;
+	}
+	size_t pageCount() const {
+		return pages.size();
+	}
 };
@@ -1480,6 +1480,7 @@ void ONScripter::commitVisualState() {
 		layer_info->commit();
 
 	queueAnimationInfo.clear();
+	invalidateZOrder(); // old_ai copies are gone
 
 	monocro_flag[BeforeScene]  = monocro_flag[AfterScene];
 	monocro_color[BeforeScene] = monocro_color[AfterScene];
@@ -1494,6 +1495,9 @@ void ONScripter::commitVisualState() {
 }
 
 void ONScripter::backupState(AnimationInfo *info) {
+	// Every change to a sprite is preceded by a backup, even for the sprites not taking part in transitions
+	invalidateZOrder();
+
 	// Do not back up sprites with transitions disabled.
 	// This enables HUD elements etc to move independently on the scene using properties without caring about what is happening ingame.
 	if (nontransitioningSprites.count(info)) {
@@ -1179,6 +1179,10 @@ int ONScripter::resetCommand() {
 	clearCurrentPage();
 	string_buffer_offset = 0;
 
+	/* ---------------------------------------- */
+	/* Rasterise the configured charset while the game starts */
+	prerenderPresetGlyphs();
+
 	setCurrentLabel("start");
 	saveSaveFile(-1);
 
@@ -2508,6 +2512,17 @@ int ONScripter::gameCommand() {
 	for (i = 0; i < script_h.global_variable_border; i++)
 		script_h.getVariableData(i).reset(false);
 
+	/* ---------------------------------------- */
+	/* Distance fields are shared through the text atlas, without it every variant would copy the field texture */
+	if (use_distance_field_glyphs && !use_text_atlas) {
+		sendToLog(LogLevel::Warn, "--sdf-glyphs requires textatlas, falling back to bitmap glyphs\n");
+		use_distance_field_glyphs = false;
+	}
+
+	/* ---------------------------------------- */
+	/* Rasterise the configured charset while the game starts */
+	prerenderPresetGlyphs();
+
 	setCurrentLabel("start");
 	saveSaveFile(-1);
 
@@ -17,6 +17,7 @@
 #include "Resources/Support/Version.hpp"
 #include "Support/Unicode.hpp"
 #include "Support/FileIO.hpp"
+#include "Support/Parallel.hpp"
 
 #if defined(IOS) && defined(USE_OBJC)
 #include "Support/Apple/UIKitWrapper.hpp"
@@ -28,6 +29,15 @@
 #include <malloc/malloc.h>
 #endif
 
+#ifdef LINUX
+#include <sys/mman.h>
+#endif
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+
 int ONScripter::zOrderOverridePreserveCommand() {
 	preserve = !preserve;
 	return RET_CONTINUE;
@@ -191,13 +201,53 @@ int ONScripter::videovolCommand() {
 	return RET_CONTINUE;
 }
 
-// verify_files %ret,"file"[,$list]
+// Computes CRC-32 of a game file, the file must not be shorter than size
+static bool hashGameFile(const char *path, size_t size, uint32_t &hash) {
+	FILE *fp = FileIO::openFile(path, "rb");
+	if (!fp)
+		return false;
+
+	uLong crc = crc32(0, nullptr, 0);
+
+#ifdef LINUX
+	// Mapping avoids copying the contents through stdio buffers
+	void *map = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileno(fp), 0) : MAP_FAILED;
+	if (map != MAP_FAILED) {
+		madvise(map, size, MADV_SEQUENTIAL);
+		auto data = static_cast<const Bytef *>(map);
+		for (size_t pos = 0; pos < size;) {
+			auto len = static_cast<uInt>(std::min<size_t>(size - pos, 0x40000000));
+			crc      = crc32(crc, data + pos, len);
+			pos += len;
+		}
+		munmap(map, size);
+		std::fclose(fp);
+		hash = static_cast<uint32_t>(crc);
+		return true;
+	}
+#endif
+
+	std::vector<Bytef> buffer(1024 * 1024);
+	size_t len;
+	while ((len = std::fread(buffer.data(), 1, buffer.size(), fp)) > 0)
+		crc = crc32(crc, buffer.data(), static_cast<uInt>(len));
+
+	bool ok = !std::ferror(fp);
+	std::fclose(fp);
+	hash = static_cast<uint32_t>(crc);
+	return ok;
+}
+
+// verify_files %ret,"file"[,$list[,%progress]]
 // -4 old hash
 // -3 invalid hash
 // -2 unsupported file
 // -1 no file
 //  0 no error
 //  1 game file validation failed
+// Files are listed in the data section as name=size with hash=size,
+// or as name=size,crc32 (in hex) with hash=crc32.
+// %progress receives the amount of checked files in permille while the check runs.
 int ONScripter::verifyFilesCommand() {
 	std::unordered_map<std::string, std::unordered_map<std::string, std::string>> fileInfo;
 
@@ -216,6 +266,7 @@ int ONScripter::verifyFilesCommand() {
 	std::string passedDate;
 
 	bool looksFine{false};
+	bool checkContents{false};
 
 	if (info != fileInfo.end() && data != fileInfo.end()) {
 		auto &infoNode = info->second;
@@ -226,14 +277,15 @@ int ONScripter::verifyFilesCommand() {
 		auto date      = infoNode.find("date");
 
 		if (game != infoNode.end() && hash != infoNode.end() && ver != infoNode.end() && apiver != infoNode.end() &&
-		    date != infoNode.end() && game->second.size() > 0 && hash->second == "size" &&
+		    date != infoNode.end() && game->second.size() > 0 && (hash->second == "size" || hash->second == "crc32") &&
 			ver->second == ONS_VERSION && apiver->second == ONS_API) {
 
 			// Try an entire match or a wild-card match.
 			looksFine = game->second.find(script_h.game_identifier) != std::string::npos;
 			if (!looksFine && game->second[game->second.size()-1] == '*')
 				looksFine = script_h.game_identifier.compare(0, game->second.size()-1, game->second, 0, game->second.size()-1) == 0;
-			passedDate = date->second;
+			passedDate    = date->second;
+			checkContents = hash->second == "crc32";
 		}
 	}
 
@@ -243,85 +295,134 @@ int ONScripter::verifyFilesCommand() {
 		return RET_CONTINUE; //dummy
 	}
 
-	// This is rather straight-forward, but our thread model needs changes anyway...
+	VariableInfo listVariable, progressVariable;
+	bool hasList{false}, hasProgress{false};
+	if (script_h.hasMoreArgs()) {
+		script_h.readVariable();
+		listVariable = script_h.current_variable;
+		hasList      = true;
+	}
+	if (script_h.hasMoreArgs()) {
+		script_h.readVariable();
+		progressVariable = script_h.current_variable;
+		hasProgress      = true;
+	}
 
-	ons.preventExit(true);
+	struct FileCheck {
+		std::string filename;
+		size_t size;
+		uint32_t hash;
+		bool missing;
+		bool modified;
+	};
+	std::vector<FileCheck> checks;
 
 	try {
 		if (passedDate != "ignore" && time(nullptr) > static_cast<time_t>(std::stoull(passedDate)) + 7 * 24 * 3600) {
 			script_h.setInt(&script_h.pushed_variable, -4);
-			while (script_h.hasMoreArgs()) script_h.readVariable();
 			return RET_CONTINUE; //dummy
 		}
 
-		std::vector<std::string> missing, modified;
-		std::string failures;
-		std::atomic_flag working = ATOMIC_FLAG_INIT;
-
-		working.test_and_set(std::memory_order_relaxed);
+		// Parse everything here, so that invalid values do not end up throwing in the workers
+		checks.reserve(data->second.size());
+		for (auto &entry : data->second) {
+			FileCheck check{entry.first, 0, 0, false, false};
+			size_t pos{0};
+			check.size = static_cast<size_t>(std::stoull(entry.second, &pos));
+			if (checkContents) {
+				if (pos >= entry.second.size() || entry.second[pos] != ',')
+					throw std::invalid_argument("No hash");
+				check.hash = static_cast<uint32_t>(std::stoul(entry.second.substr(pos + 1), nullptr, 16));
+			}
+			translatePathSlashes(check.filename);
+			checks.emplace_back(std::move(check));
+		}
+	} catch (...) { // std::invalid_argument and std::out_of_range
+		script_h.setInt(&script_h.pushed_variable, -3);
+		return RET_CONTINUE;
+	}
 
-		auto verifyFiles = [&working, &data, &missing, &modified, &failures]() {
-			for (auto &entry : data->second) {
-				size_t size, readSize;
+	// The order of the ini section is arbitrary, keep the report stable
+	std::sort(checks.begin(), checks.end(), [](const FileCheck &a, const FileCheck &b) {
+		return a.filename < b.filename;
+	});
 
-				size = static_cast<size_t>(std::stoull(entry.second));
+	ons.preventExit(true);
 
-				auto filename = entry.first;
-				translatePathSlashes(filename);
-				auto path = ons.script_h.reader->completePath(filename.c_str(), FileType::File, &readSize);
+	std::atomic<size_t> doneChecks{0};
+	std::atomic<bool> cancelled{false};
 
-				if (path) {
-					freearr(&path);
-					if (size != readSize) {
-						failures += "{c:FFA500:" + filename + "}\n";
-						modified.emplace_back(filename);
-					}
-				} else {
-					failures += "{c:FF0000:" + filename + "}\n";
-					missing.emplace_back(filename);
-				}
-			}
+	auto verifyFile = [this, &checks, &doneChecks, &cancelled, checkContents](size_t i) {
+		if (cancelled.load(std::memory_order_relaxed))
+			return;
 
-			working.clear(std::memory_order_release);
-			return 0;
-		};
+		auto &check = checks[i];
+		size_t readSize;
+		auto path = script_h.reader->completePath(check.filename.c_str(), FileType::File, &readSize);
 
-		auto verifyThread = SDL_CreateThread(cmp::lambda_ptr<int>(verifyFiles), "Verification", &verifyFiles);
-		if (verifyThread) {
-			SDL_DetachThread(verifyThread);
+		if (path) {
+			uint32_t hash;
+			check.modified = check.size != readSize ||
+			                 (checkContents && (!hashGameFile(path, readSize, hash) || hash != check.hash));
+			freearr(&path);
 		} else {
-			sendToLog(LogLevel::Warn, "Failed to create verification thread...\n");
-			verifyFiles();
+			check.missing = true;
 		}
 
-		auto delay = 1000 / (ons.game_fps ? ons.game_fps : DEFAULT_FPS);
-		do {
-			waitEvent(delay);
-		} while (working.test_and_set(std::memory_order_acquire));
+		doneChecks.fetch_add(1, std::memory_order_release);
+	};
 
-		if (!missing.empty()) {
-			sendToLog(LogLevel::Error, "Missing files\n");
-			for (auto &filename : missing)
-				sendToLog(LogLevel::Error, "%s\n", filename.c_str());
+	// Checks are mostly bound by storage, a few workers are enough to saturate it
+	ParallelJobs verification(checks.size(), verifyFile, "Verification", parallelThreadCount());
+	if (!verification.threadCount() && !checks.empty()) {
+		sendToLog(LogLevel::Warn, "Failed to create verification threads...\n");
+		verification.help();
+	}
+
+	auto delay = 1000 / (ons.game_fps ? ons.game_fps : DEFAULT_FPS);
+	while (doneChecks.load(std::memory_order_acquire) < checks.size() && !cancelled.load(std::memory_order_relaxed)) {
+		if (hasProgress)
+			script_h.setInt(&progressVariable, static_cast<int32_t>(doneChecks.load(std::memory_order_relaxed) * 1000 / checks.size()));
+		waitEvent(delay);
+		// Stop early when the game is about to quit, workers finish their current file only
+		if (exitCode.load(std::memory_order_relaxed) != ExitType::None)
+			cancelled.store(true, std::memory_order_relaxed);
+	}
+
+	verification.join();
+
+	std::string failures;
+	std::vector<std::string> missing, modified;
+	for (auto &check : checks) {
+		if (check.missing) {
+			failures += "{c:FF0000:" + check.filename + "}\n";
+			missing.emplace_back(check.filename);
+		} else if (check.modified) {
+			failures += "{c:FFA500:" + check.filename + "}\n";
+			modified.emplace_back(check.filename);
 		}
+	}
 
-		if (!modified.empty()) {
-			sendToLog(LogLevel::Error, "Modified files\n");
-			for (auto &filename : modified)
-				sendToLog(LogLevel::Error, "%s\n", filename.c_str());
-		}
+	if (!missing.empty()) {
+		sendToLog(LogLevel::Error, "Missing files\n");
+		for (auto &filename : missing)
+			sendToLog(LogLevel::Error, "%s\n", filename.c_str());
+	}
 
-		script_h.setInt(&script_h.pushed_variable, !failures.empty());
+	if (!modified.empty()) {
+		sendToLog(LogLevel::Error, "Modified files\n");
+		for (auto &filename : modified)
+			sendToLog(LogLevel::Error, "%s\n", filename.c_str());
+	}
 
-		if (script_h.hasMoreArgs()) {
-			script_h.readVariable();
-			script_h.setStr(&script_h.getVariableData(script_h.current_variable.var_no).str, failures.c_str());
-		}
+	// An interrupted check cannot vouch for the files
+	bool failed = !failures.empty() || cancelled.load(std::memory_order_relaxed);
+	script_h.setInt(&script_h.pushed_variable, failed);
 
-	} catch (...) { // std::invalid_argument and std::out_of_range
-		script_h.setInt(&script_h.pushed_variable, -3);
-		while (script_h.hasMoreArgs()) script_h.readVariable();
-	}
+	if (hasList)
+		script_h.setStr(&script_h.getVariableData(listVariable.var_no).str, failures.c_str());
+	if (hasProgress)
+		script_h.setInt(&progressVariable, 1000);
 
 	ons.preventExit(false);
 
@@ -388,8 +388,9 @@ void ONScripter::waitEvent(int count, bool nopPreferred) {
 			// put it in a string
 			size_t len        = 128 + std::strlen(wm_title_string);
 			char *titlestring = new char[len];
-			std::snprintf(titlestring, len, "[Renderer: %s / TPF: %.3f ms / FPS: %.3f] %s%s",
-			              gpu.current_renderer->name, av, 1000.0 / av, volume_on_flag ? "" : "[Sound: Off] ", wm_title_string);
+			std::snprintf(titlestring, len, "[Renderer: %s / TPF: %.3f ms / FPS: %.3f / Glyph lookups: %zu] %s%s",
+			              gpu.current_renderer->name, av, 1000.0 / av, glyphCache.takeLookups(),
+			              volume_on_flag ? "" : "[Sound: Off] ", wm_title_string);
 			// set the title
 			window.setTitle(titlestring);
 			freearr(&titlestring);
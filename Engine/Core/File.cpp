@@ -730,6 +730,7 @@ void ONScripter::loadSaveFileData() {
 		readAnimationInfo(sprite_info[i]);
 		readAnimationInfo(sprite2_info[i]);
 	}
+	invalidateZOrder();
 
 	btndef_info.remove();
 	readStr(&btndef_info.image_name);
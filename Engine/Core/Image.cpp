@@ -17,6 +17,7 @@
 
 #include <SDL2/SDL_thread.h>
 
+#include <algorithm>
 #include <new>
 #include <string>
 #include <map>
@@ -275,10 +276,12 @@ SDL_Surface *ONScripter::createSurfaceFromFile(const char *filename) {
 
 	size_t length{0};
 	uint8_t *buffer{nullptr};
+	const uint8_t *view{nullptr};
 
+	// Readers are reentrant, only the decoders below need serialisation
 	if (filename[0]) {
-		Lock lock(&surfaceCreationLockVar);
-		script_h.reader->getFile(filename, length, &buffer);
+		if (!script_h.reader->getFileView(filename, length, &view))
+			script_h.reader->getFile(filename, length, &buffer);
 	}
 
 	if (length == 0) {
@@ -300,7 +303,7 @@ SDL_Surface *ONScripter::createSurfaceFromFile(const char *filename) {
 		script_h.findAndAddLog(script_h.log_info[ScriptHandler::FILE_LOG], filename, true);
 
 	const char *ext  = std::strrchr(filename, '.');
-	SDL_RWops *src   = SDL_RWFromMem(buffer, static_cast<int>(length));
+	SDL_RWops *src   = view ? SDL_RWFromConstMem(view, static_cast<int>(length)) : SDL_RWFromMem(buffer, static_cast<int>(length));
 	SDL_Surface *tmp = nullptr;
 
 	if (ext && (equalstr(ext + 1, "PNG") || equalstr(ext + 1, "png"))) {
@@ -417,9 +420,10 @@ bool ONScripter::colorGlyph(const GlyphParams *key, GlyphValues *glyph, SDL_Colo
 
 	// is atlas a place we are blitting from
 	bool src_atlas     = ((!border && glyph->glyph_pos.has()) || (border && glyph->border_pos.has()));
-	GPU_Image *src_img = src_atlas ? glyphAtlas.atlas : (border ? glyph->border_gpu : glyph->glyph_gpu);
+	GPU_Image *src_img = src_atlas ? glyphAtlas.image(border ? glyph->border_page : glyph->glyph_page) : (border ? glyph->border_gpu : glyph->glyph_gpu);
 	GPU_Rect *src_rect = !src_atlas ? nullptr : (border ? &glyph->border_pos.get() : &glyph->glyph_pos.get());
 	std::unique_ptr<GPU_Rect> dst_rect;
+	uint32_t dst_page{0};
 
 	if (src_img == nullptr || color == nullptr) {
 		return true;
@@ -437,7 +441,7 @@ bool ONScripter::colorGlyph(const GlyphParams *key, GlyphValues *glyph, SDL_Colo
 		GPU_GetTarget(tmp);
 		target   = tmp->target;
 		dst_rect = std::make_unique<GPU_Rect>();
-		if (atlas->add(tmp->w + 2, tmp->h + 2, *dst_rect)) {
+		if (atlas->add(tmp->w + 2, tmp->h + 2, *dst_rect, dst_page)) {
 			x = dst_rect->x + tmp->w / 2.0;
 			y = dst_rect->y + tmp->h / 2.0;
 		} else {
@@ -446,7 +450,7 @@ bool ONScripter::colorGlyph(const GlyphParams *key, GlyphValues *glyph, SDL_Colo
 		}
 	} else if (!src_rect && atlas) { // case 3
 		dst_rect = std::make_unique<GPU_Rect>();
-		if (atlas->add(src_img->w + 2, src_img->h + 2, *dst_rect)) {
+		if (atlas->add(src_img->w + 2, src_img->h + 2, *dst_rect, dst_page)) {
 			x = dst_rect->x + dst_rect->w / 2.0;
 			y = dst_rect->y + dst_rect->h / 2.0;
 		} else {
@@ -490,8 +494,8 @@ bool ONScripter::colorGlyph(const GlyphParams *key, GlyphValues *glyph, SDL_Colo
 
 		gpu.unsetShaderProgram();
 		GPU_SetBlending(actual_src, true);
-		if (atlas && target == atlas->atlas->target)
-			gpu.simulateRead(atlas->atlas);
+		if (atlas && target == atlas->image(dst_page)->target)
+			gpu.simulateRead(atlas->image(dst_page));
 	} else {
 		//Don't take alpha into account
 		if (color->r == 0 && color->b == 0 && color->g == 0) {
@@ -524,18 +528,20 @@ bool ONScripter::colorGlyph(const GlyphParams *key, GlyphValues *glyph, SDL_Colo
 
 		gpu.unsetShaderProgram();
 		GPU_SetBlending(actual_src, true);
-		if (atlas && target == atlas->atlas->target)
-			gpu.simulateRead(atlas->atlas);
+		if (atlas && target == atlas->image(dst_page)->target)
+			gpu.simulateRead(atlas->image(dst_page));
 	}
 
 	if (tmp) {
-		gpu.copyGPUImage(tmp, nullptr, dst_rect.get(), atlas->atlas->target, x, y, 1, 1, 0, true);
+		gpu.copyGPUImage(tmp, nullptr, dst_rect.get(), atlas->image(dst_page)->target, x, y, 1, 1, 0, true);
 		gpu.freeImage(tmp);
-		gpu.simulateRead(atlas->atlas);
+		gpu.simulateRead(atlas->image(dst_page));
 	}
 
-	if (dst_rect.get())
+	if (dst_rect.get()) {
 		(border ? glyph->border_pos : glyph->glyph_pos).set(*dst_rect);
+		(border ? glyph->border_page : glyph->glyph_page) = dst_page;
+	}
 
 	if (src_needs_copy)
 		gpu.freeImage(actual_src);
@@ -751,43 +757,62 @@ void ONScripter::cleanSpritesetCache(SpritesetInfo *spriteset, bool before) {
 	ssim.clearImage();
 }
 
-void ONScripter::setupZLevels(int refresh_mode) {
-	spriteZLevels.clear();
-	for (auto ai : sprites(SPRITE_LSP | SPRITE_LSP2, true)) {
-		auto spr = ai->oldNew(refresh_mode);
+const std::vector<ONScripter::ZOrderedSprite> &ONScripter::setupZLevels(int refresh_mode) {
+	bool before = refresh_mode & REFRESH_BEFORESCENE_MODE;
+	auto &order = spriteZOrder[before];
+	if (!spriteZOrderDirty[before])
+		return order;
+
+	order.clear();
+	auto add = [&order, refresh_mode](AnimationInfo &ai) {
+		auto spr = ai.oldNew(refresh_mode);
 		if (spr->exists)
-			spriteZLevels[spr->has_z_order_override ? spr->z_order_override : spr->id].insert(spr);
+			order.push_back({spr->has_z_order_override ? spr->z_order_override : spr->id, spr});
+	};
+	for (int i = 0; i < MAX_SPRITE_NUM; i++) {
+		add(sprite_info[i]);
+		add(sprite2_info[i]);
 	}
+
+	// Higher z levels first, then higher ids, lsp before lsp2 of the same id
+	std::sort(order.begin(), order.end(), [](const ZOrderedSprite &a, const ZOrderedSprite &b) {
+		if (a.z != b.z)
+			return a.z > b.z;
+		if (a.ai->id != b.ai->id)
+			return a.ai->id > b.ai->id;
+		return a.ai->type == SPRITE_LSP && b.ai->type != SPRITE_LSP;
+	});
+
+	spriteZOrderDirty[before] = false;
+	return order;
 }
 
 // Helper function for refreshSceneTo & refreshHudTo.
 void ONScripter::drawSpritesBetween(int upper_inclusive, int lower_exclusive, GPU_Target *target, GPU_Rect *clip_dst, int refresh_mode) {
-	for (int i = upper_inclusive; i > lower_exclusive; i--) {
-		if (refresh_mode & REFRESH_SAYA_MODE && i <= 9)
+	auto &order = setupZLevels(refresh_mode);
+	// The order is descending, so this finds the first sprite at or below upper_inclusive
+	auto it = std::lower_bound(order.begin(), order.end(), upper_inclusive, [](const ZOrderedSprite &s, int z) { return s.z > z; });
+
+	for (; it != order.end() && it->z > lower_exclusive; ++it) {
+		if (refresh_mode & REFRESH_SAYA_MODE && it->z <= 9)
 			return;
 
-		auto z = spriteZLevels.find(i);
-		if (z == spriteZLevels.end())
+		AnimationInfo *spr = it->ai;
+		// Don't display:
+		// LSP sprites if those are hidden
+		if (spr->type == SPRITE_LSP && all_sprite_hide_flag)
 			continue;
-
-		for (AnimationInfo *spr : z->second) {
-			// Will iterate through sprites in correct z order using cmpById
-			// Don't display:
-			// LSP sprites if those are hidden
-			if (spr->type == SPRITE_LSP && all_sprite_hide_flag)
-				continue;
-			// LSP2 sprites if those are hidden
-			if (spr->type == SPRITE_LSP2 && all_sprite2_hide_flag)
-				continue;
-			// Sprites that have no image and don't have the excuse that they're layers
-			if (!spr->exists)
-				continue;
-			// Invisible sprites
-			if (!spr->visible)
-				continue;
-			// Draw it!
-			drawToGPUTarget(target, spr, refresh_mode, clip_dst, spr->type == SPRITE_LSP2);
-		}
+		// LSP2 sprites if those are hidden
+		if (spr->type == SPRITE_LSP2 && all_sprite2_hide_flag)
+			continue;
+		// Sprites that have no image and don't have the excuse that they're layers
+		if (!spr->exists)
+			continue;
+		// Invisible sprites
+		if (!spr->visible)
+			continue;
+		// Draw it!
+		drawToGPUTarget(target, spr, refresh_mode, clip_dst, spr->type == SPRITE_LSP2);
 	}
 }
 
@@ -819,8 +844,6 @@ void ONScripter::refreshSceneTo(GPU_Target *target, GPU_Rect *passed_script_clip
 		errorAndExit("z_orders are somehow wrong. Make sure max > humanz > spriteset(1) > spriteset(2) > ... > hudz > windowz > 0.");
 	}
 
-	setupZLevels(rm);
-
 	GPU_Rect script_clip_dst = full_script_clip;
 	if (passed_script_clip_dst)
 		if (doClipping(&script_clip_dst, passed_script_clip_dst))
@@ -120,6 +120,7 @@ void *__wrap_SDL_LoadObject(const char *sofile) {
 	printf("     --use-app-icons              use the icns for the current application, if bundled/embedded\n");
 	printf("     --gameid id                  set game identifier (like with game.id)\n");
 	printf("     --game-script                set game script filename\n");
+	printf("     --no-script-cache            do not keep the prepared game script between launches\n");
 	printf("     --fullscreen                 start in fullscreen mode\n");
 	printf("     --window                     start in window mode\n");
 	printf("     --scale                      scale game to native display size when in fullscreen mode.\n");
@@ -163,8 +164,15 @@ void *__wrap_SDL_LoadObject(const char *sofile) {
 	printf("     --strict                     treat warnings more like errors\n");
 	printf("     --debug                      generate runtime debugging output (use multiple times to increase debug level)\n");
 	printf("     --check-file-case            attempt to check file case on case-insensitive file systems\n");
+#ifdef LINUX
+	printf("     --watch-files                notice loose game files added or removed while running\n");
+	printf("     --benchmark-script label     run the script from label without a window and print per-command timings\n");
+	printf("     --benchmark-limit count      stop the script benchmark after this many commands (default: 10000000)\n");
+#endif
 	printf("     --show-fps                   display a ms/frame counter in the window title\n");
 	printf("     --force-fps value            override all fps changes to this value\n");
+	printf("     --glyph-charset file         rasterise the characters of this UTF-8 file for every text preset in the background\n");
+	printf("     --sdf-glyphs                 render text from one scalable distance field per character and style\n");
 	printf("     --cursor                     set cursor parameters: hide, show, auto are supported (default: auto)\n");
 	printf("     --pad-map                    provide custom button mapping for a gamepad\n");
 	printf("     --prefer-rumble              specify preferred method of gamepad rumble (sdl/libusb)\n");
@@ -332,6 +340,18 @@ static void parseOptions(int argc, char **argv, bool &hasArchivePath) {
 				ons.add_debug_level();
 			} else if (!std::strcmp(argv[0] + 1, "-check-file-case")) {
 				FileIO::setPathCaseValidation(true);
+			} else if (!std::strcmp(argv[0] + 1, "-watch-files")) {
+				DirectReader::setFileWatching(true);
+#ifdef LINUX
+			} else if (!std::strcmp(argv[0] + 1, "-benchmark-script")) {
+				argc--;
+				argv++;
+				ons.ons_cfg_options["benchmark-script"] = argv[0];
+			} else if (!std::strcmp(argv[0] + 1, "-benchmark-limit")) {
+				argc--;
+				argv++;
+				ons.ons_cfg_options["benchmark-limit"] = argv[0];
+#endif
 			} else if (!std::strcmp(argv[0] + 1, "-allow-color-type-only")) {
 				ons.allow_color_type_only                    = true;
 				ons.ons_cfg_options["allow-color-type-only"] = "noval";
@@ -376,8 +396,17 @@ static void parseOptions(int argc, char **argv, bool &hasArchivePath) {
 				argc--;
 				argv++;
 				ons.ons_cfg_options["force-fps"] = argv[0];
+			} else if (!std::strcmp(argv[0] + 1, "-glyph-charset")) {
+				argc--;
+				argv++;
+				ons.ons_cfg_options["glyph-charset"] = argv[0];
+			} else if (!std::strcmp(argv[0] + 1, "-sdf-glyphs")) {
+				ons.use_distance_field_glyphs     = true;
+				ons.ons_cfg_options["sdf-glyphs"] = "noval";
 			} else if (!std::strcmp(argv[0] + 1, "-disable-icloud")) {
 				ons.ons_cfg_options["disable-icloud"] = "noval";
+			} else if (!std::strcmp(argv[0] + 1, "-no-script-cache")) {
+				ons.ons_cfg_options["no-script-cache"] = "noval";
 			} else if (!std::strcmp(argv[0] + 1, "-force-vsync")) {
 				ons.ons_cfg_options["force-vsync"] = "noval";
 			} else if (!std::strcmp(argv[0] + 1, "-try-late-swap")) {
@@ -867,6 +896,15 @@ int main(int argc, char **argv) {
 	// }
 	// Deinitialisation is done automatically by ctrl.quit(exit_code);
 
+#ifdef LINUX
+	auto benchmark = ons.ons_cfg_options.find("benchmark-script");
+	if (benchmark != ons.ons_cfg_options.end()) {
+		auto limit = ons.ons_cfg_options.find("benchmark-limit");
+		ctrl.quit(ons.benchmarkScript(benchmark->second.c_str(),
+		                              limit != ons.ons_cfg_options.end() ? std::strtoull(limit->second.c_str(), nullptr, 10) : 10000000));
+	}
+#endif
+
 	if (ons.init())
 		ctrl.quit(-1);
 	ons.executeLabel();
@@ -46,7 +46,7 @@ const int DEFAULT_WM_ICON_H = 32;
 const int DEFAULT_FONT_SIZE = 26;
 
 using CommandFunc = int (ONScripter::*)();
-static std::unordered_map<HashedString, CommandFunc> func_lut{
+static PerfectHashMap<CommandFunc> func_lut{
     {"z_order_override2", &ONScripter::zOrderOverrideCommand},
     {"z_order_override", &ONScripter::zOrderOverrideCommand},
     {"z_override_preserve", &ONScripter::zOrderOverridePreserveCommand},
@@ -810,7 +810,8 @@ ONScripter::ONScripter()
     : ScriptParser(this),
       glyphCache(NUM_GLYPH_CACHE),
       glyphMeasureCache(NUM_GLYPH_CACHE),
-      glyphAtlas(GLYPH_ATLAS_W, GLYPH_ATLAS_H) {
+      glyphAtlas(GLYPH_ATLAS_W, GLYPH_ATLAS_H, GLYPH_ATLAS_PAGES),
+      glyphAtlasPageKeys(GLYPH_ATLAS_PAGES) {
 	//first initialize *everything* (static) to base values
 
 	resetFlags();
@@ -1205,6 +1206,7 @@ void ONScripter::resetSub() {
 		sprite_info[i].reset();
 		sprite2_info[i].reset();
 	}
+	invalidateZOrder();
 	barclearCommand();
 	prnumclearCommand();
 	for (i = 0; i < 2; i++) cursor_info[i].reset();
@@ -2001,6 +2003,196 @@ void ONScripter::runScript() {
 		this->parseLine();
 }
 
+#ifdef LINUX
+#ifdef BENCHMARK_ALLOCATIONS
+// Only the thread running the script benchmark enables counting, the flag and the counter are per thread
+static thread_local bool benchmarkCountAllocations{false};
+static thread_local uint64_t benchmarkAllocations{0};
+
+void *operator new(size_t size) {
+	if (benchmarkCountAllocations)
+		benchmarkAllocations++;
+	while (true) {
+		void *ptr = std::malloc(size ? size : 1);
+		if (ptr)
+			return ptr;
+		auto handler = std::get_new_handler();
+		if (!handler)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+static void countBenchmarkAllocations(bool enable) {
+	benchmarkCountAllocations = enable;
+}
+
+static uint64_t benchmarkAllocationCount() {
+	return benchmarkAllocations;
+}
+#else
+// Regular builds keep the default allocator, configure with --count-allocations to measure them
+static void countBenchmarkAllocations(bool) {}
+
+static uint64_t benchmarkAllocationCount() {
+	return 0;
+}
+#endif
+
+int ONScripter::benchmarkScript(const char *label, uint64_t limit) {
+	// Only the script is needed: no window, renderer, audio or fonts are initialised
+	if (archive_path.getPathNum() == 0)
+		archive_path.add(script_path);
+	if (SDL_Init(0) || open())
+		return -1;
+
+	// Engine commands that only move around the script or compute values, the rest is skipped
+	static const std::unordered_set<std::string> benchmarkCommands{
+	    "goto", "jumpf", "jumpb", "tablegoto", "rnd", "rnd2", "split"};
+
+	struct CommandStats {
+		uint64_t time{0};
+		uint64_t runs{0};
+		uint64_t allocations{0};
+	};
+	std::unordered_map<std::string, CommandStats> stats;
+	uint64_t executed{0}, skipped{0};
+
+	std::srand(0);
+	skip_mode  = SKIP_NORMAL | SKIP_SUPERSKIP;
+	break_flag = false;
+	setCurrentLabel(label);
+	readToken();
+
+	auto start = SDL_GetPerformanceCounter();
+	bool ended = false;
+	while (!ended && executed + skipped < limit) {
+		while (current_line < current_label_info->num_of_lines && executed + skipped < limit) {
+			if (script_h.getStringBufferR()[0] == '~') {
+				last_tilde.next_script = script_h.getNext();
+				readToken();
+				continue;
+			}
+			if (break_flag && !script_h.isName("next", true)) {
+				if (script_h.getStringBufferR()[0] == 0x0a)
+					current_line++;
+				if ((script_h.getStringBufferR()[0] != ':') &&
+				    (script_h.getStringBufferR()[0] != ';') &&
+				    (script_h.getStringBufferR()[0] != 0x0a))
+					script_h.skipToken();
+				readToken();
+				continue;
+			}
+
+			auto commandStart       = SDL_GetPerformanceCounter();
+			auto commandAllocations = benchmarkAllocationCount();
+			countBenchmarkAllocations(true);
+
+			bool measured = true;
+			int ret       = ScriptParser::parseLine();
+			if (ret == RET_NOMATCH) {
+				const char *cmd = script_h.current_cmd;
+				if (script_h.getStringBufferR()[0] == 0x0a) {
+					measured = false;
+					ret      = RET_CONTINUE | RET_EOL;
+				} else if (equalstr(cmd, "end")) {
+					ended = true;
+					ret   = RET_CONTINUE;
+				} else if (equalstr(cmd, "game")) {
+					// Same as gameCommand without the cursors, text page and save file
+					current_mode = NORMAL_MODE;
+					for (int i = 0; i < script_h.global_variable_border; i++)
+						script_h.getVariableData(i).reset(false);
+					setCurrentLabel("start");
+					ret = RET_CONTINUE;
+				} else if (benchmarkCommands.count(cmd)) {
+					ret = this->parseLine();
+				} else {
+					script_h.skipToken();
+					skipped++;
+					measured = false;
+					ret      = RET_CONTINUE;
+				}
+			}
+
+			countBenchmarkAllocations(false);
+			if (measured && script_h.current_cmd[0] != '\0') {
+				auto &cmd = stats[script_h.current_cmd];
+				cmd.time += SDL_GetPerformanceCounter() - commandStart;
+				cmd.allocations += benchmarkAllocationCount() - commandAllocations;
+				cmd.runs++;
+				executed++;
+			}
+			if (ended)
+				break;
+
+			if (ret & (RET_SKIP_LINE | RET_EOL)) {
+				if (ret & RET_SKIP_LINE)
+					script_h.skipLine();
+				if (++current_line >= current_label_info->num_of_lines)
+					break;
+			}
+
+			if (!(ret & RET_NO_READ))
+				readToken();
+		}
+
+		if (ended || executed + skipped >= limit)
+			break;
+
+		current_label_info = script_h.lookupLabelNext(current_label_info->name);
+		current_line       = 0;
+		if (current_label_info->start_address == nullptr)
+			break;
+		script_h.setCurrent(current_label_info->label_header);
+		readToken();
+	}
+	auto time = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+	std::vector<std::pair<std::string, CommandStats>> sorted(stats.begin(), stats.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, CommandStats> &a, const std::pair<std::string, CommandStats> &b) {
+		return a.second.time > b.second.time;
+	});
+
+	sendToLog(LogLevel::Info, "Script benchmark from *%s: %llu commands executed, %llu skipped in %.3f s\n",
+	          label, static_cast<unsigned long long>(executed), static_cast<unsigned long long>(skipped), time);
+	double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+#ifdef BENCHMARK_ALLOCATIONS
+	uint64_t allocations{0};
+	for (auto &cmd : sorted) allocations += cmd.second.allocations;
+
+	sendToLog(LogLevel::Info, "%.0f commands/s, %llu allocations\n", time > 0 ? executed / time : 0.0,
+	          static_cast<unsigned long long>(allocations));
+	sendToLog(LogLevel::Info, "Command,Runs,Total us,Average ns,Allocations\n");
+	for (auto &cmd : sorted) {
+		auto &s = cmd.second;
+		sendToLog(LogLevel::Info, "%s,%llu,%.0f,%.0f,%llu\n", cmd.first.c_str(), static_cast<unsigned long long>(s.runs),
+		          s.time * 1000000.0 / frequency, s.time * 1000000000.0 / frequency / s.runs,
+		          static_cast<unsigned long long>(s.allocations));
+	}
+#else
+	sendToLog(LogLevel::Info, "%.0f commands/s, allocation counting disabled (configure --count-allocations)\n",
+	          time > 0 ? executed / time : 0.0);
+	sendToLog(LogLevel::Info, "Command,Runs,Total us,Average ns\n");
+	for (auto &cmd : sorted) {
+		auto &s = cmd.second;
+		sendToLog(LogLevel::Info, "%s,%llu,%.0f,%.0f\n", cmd.first.c_str(), static_cast<unsigned long long>(s.runs),
+		          s.time * 1000000.0 / frequency, s.time * 1000000000.0 / frequency / s.runs);
+	}
+#endif
+
+	return 0;
+}
+#endif
+
 bool ONScripter::isBuiltInCommand(const char *cmd) {
 	return ScriptParser::isBuiltInCommand(cmd) || func_lut.count(cmd[0] == '_' ? cmd + 1 : cmd);
 }
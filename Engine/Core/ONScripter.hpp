@@ -123,6 +123,9 @@ public:
 	bool scriptExecutionPermitted();
 	void executeLabel();
 	void runScript();
+#ifdef LINUX
+	int benchmarkScript(const char *label, uint64_t limit);
+#endif
 
 	// ----------------------------------------
 	// start-up options
@@ -990,12 +993,13 @@ private:
 	bool all_sprite2_hide_flag;
 	bool preserve{false};
 
-	struct cmpById {
-		bool operator()(const AnimationInfo *a, const AnimationInfo *b) const {
-			return a->id > b->id || (a->id == b->id && a->type == SPRITE_LSP);
-		}
+	struct ZOrderedSprite {
+		int z;
+		AnimationInfo *ai;
 	};
-	std::unordered_map<int, std::set<AnimationInfo *, cmpById>> spriteZLevels;
+	// Existing LSP and LSP2 sprites from the top z level down, indexed by REFRESH_BEFORESCENE_MODE
+	std::vector<ZOrderedSprite> spriteZOrder[2];
+	bool spriteZOrderDirty[2]{true, true};
 
 	std::map<int, SpritesetInfo> spritesets;
 	std::set<AnimationInfo *> nontransitioningSprites;
@@ -1161,9 +1165,12 @@ private:
 	void setwindowCore();
 
 public: // DialogueController wants access to this
-	void resetGlyphCache();
+	void cacheGlyph(const GlyphParams &key, GlyphValues *glyph);
+	void evictGlyphAtlasPage();
+	void prerenderPresetGlyphs();
 	void renderGlyphValues(const GlyphValues &values, GPU_Rect *dst_clip, TextRenderingState::TextRenderingDst dst, float x, float y, float r, bool render_border, int alpha);
 	const GlyphValues *renderUnicodeGlyph(Font *font, GlyphParams *key);
+	const GlyphValues *renderDistanceFieldGlyph(Font *font, GlyphParams *key);
 	const GlyphValues *measureUnicodeGlyph(Font *font, GlyphParams *key);
 	bool isAlphanumeric(char16_t codepoint);
 	void processSpecialCharacters(std::u16string &text, Fontinfo &info, Fontinfo::InlineOverrides &io);
@@ -1254,6 +1261,10 @@ private:
 
 public:
 	void backupState(AnimationInfo *info);
+	// Must be called whenever a sprite appears, disappears or changes its z level
+	void invalidateZOrder() {
+		spriteZOrderDirty[0] = spriteZOrderDirty[1] = true;
+	}
 
 private:
 	void commitSpriteset(SpritesetInfo *si);
@@ -1547,9 +1558,13 @@ private:
 
 	/* ---------------------------------------- */
 	/* Our caches :) */
-	LRUCache<GlyphParams, GlyphValues *, std::unordered_map, GlyphParamsHash, GlyphParamsEqual> glyphCache;
-	LRUCache<GlyphParams, GlyphValues *, std::unordered_map, GlyphParamsHash, GlyphParamsEqual> glyphMeasureCache;
+	GlyphCache glyphCache;
+	GlyphCache glyphMeasureCache;
 	GlyphAtlasController glyphAtlas;
+	std::vector<std::vector<GlyphParams>> glyphAtlasPageKeys;
+	// What prerenderPresetGlyphs last queued, so that reset does not rasterise it again
+	std::string prerenderedCharset;
+	std::vector<GlyphParams> prerenderedPresetKeys;
 
 	ImageCacheController imageCache;
 	SoundCacheController soundCache;
@@ -1601,7 +1616,7 @@ private:
 	void refreshSceneTo(GPU_Target *target, GPU_Rect *passed_script_clip_dst, int refresh_mode = REFRESH_NORMAL_MODE);
 	void refreshHudTo(GPU_Target *target, GPU_Rect *passed_script_clip_dst, int refresh_mode = REFRESH_NORMAL_MODE);
 
-	void setupZLevels(int refresh_mode);
+	const std::vector<ZOrderedSprite> &setupZLevels(int refresh_mode);
 	void drawSpritesBetween(int upper_inclusive, int lower_exclusive, GPU_Target *target, GPU_Rect *clip_dst, int refresh_mode);
 	void loadBreakupCellforms();
 	void createBackground();
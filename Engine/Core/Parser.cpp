@@ -17,7 +17,7 @@
 #include <utility>
 
 using CommandFunc = int (ScriptParser::*)();
-static std::unordered_map<HashedString, CommandFunc> func_lut{
+static PerfectHashMap<CommandFunc> func_lut{
     {"windowz", &ScriptParser::windowzCommand},
     {"uninterruptible", &ScriptParser::uninterruptibleCommand},
     {"timestamp", &ScriptParser::timeStampCommand},
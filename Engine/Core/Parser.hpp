@@ -288,6 +288,7 @@ public:
 	std::unordered_set<const char *> uninterruptibleLabels;
 	LabelInfo *current_label_info;
 	bool use_text_atlas{false};
+	bool use_distance_field_glyphs{false};
 	int current_line;
 	//CHECKME: not initialized? any of this? resetDefineFlags seems to be the thing initting our stuff and it is missing current_line + other things?
 
@@ -71,47 +71,97 @@ extern void seqmusicCallback(int sig);
 	 ((buf)[3] != 0xFF) && ((buf)[4] != 0xFF) && !((buf)[5] & 0x1F))
 
 struct OVInfo {
-	uint8_t *buf;
-	ogg_int64_t length;
-	ogg_int64_t pos;
+	SDL_RWops *src;
 	OggVorbis_File ovf;
 };
 
 static size_t oc_read_func(void *ptr, size_t size, size_t nmemb, void *datasource) {
 	OVInfo *ogg_vorbis_info = static_cast<OVInfo *>(datasource);
 
-	size_t len = size * nmemb;
-	if (static_cast<size_t>(ogg_vorbis_info->pos) + len > static_cast<size_t>(ogg_vorbis_info->length))
-		len = static_cast<size_t>(ogg_vorbis_info->length - ogg_vorbis_info->pos);
-	std::memcpy(ptr, ogg_vorbis_info->buf + ogg_vorbis_info->pos, len);
-	ogg_vorbis_info->pos += len;
-
-	return len;
+	return SDL_RWread(ogg_vorbis_info->src, ptr, 1, size * nmemb);
 }
 
 static int oc_seek_func(void *datasource, ogg_int64_t offset, int whence) {
 	OVInfo *ogg_vorbis_info = static_cast<OVInfo *>(datasource);
 
-	ogg_int64_t pos = 0;
-	if (whence == 0)
-		pos = offset;
-	else if (whence == 1)
-		pos = ogg_vorbis_info->pos + offset;
-	else if (whence == 2)
-		pos = ogg_vorbis_info->length + offset;
-
-	if (pos < 0 || pos > ogg_vorbis_info->length)
+	// whence values match RW_SEEK_SET, RW_SEEK_CUR and RW_SEEK_END
+	if (SDL_RWseek(ogg_vorbis_info->src, offset, whence) < 0)
 		return -1;
 
-	ogg_vorbis_info->pos = pos;
-
 	return 0;
 }
 
 static long oc_tell_func(void *datasource) {
 	OVInfo *ogg_vorbis_info = static_cast<OVInfo *>(datasource);
 
-	return static_cast<long>(ogg_vorbis_info->pos);
+	return static_cast<long>(SDL_RWtell(ogg_vorbis_info->src));
+}
+
+// Reader stream exposed as SDL_RWops, positions are relative to start within the stream
+struct RWStreamInfo {
+	std::unique_ptr<BaseReader::Stream> stream;
+	int64_t start;
+};
+
+static Sint64 rw_size_func(SDL_RWops *context) {
+	auto info = static_cast<RWStreamInfo *>(context->hidden.unknown.data1);
+
+	return static_cast<Sint64>(info->stream->size()) - info->start;
+}
+
+static Sint64 rw_seek_func(SDL_RWops *context, Sint64 offset, int whence) {
+	auto info = static_cast<RWStreamInfo *>(context->hidden.unknown.data1);
+
+	if (whence == RW_SEEK_SET)
+		offset += info->start;
+	else if (whence == RW_SEEK_CUR && static_cast<int64_t>(info->stream->tell()) + offset < info->start)
+		return SDL_SetError("Seek before the beginning of the stream");
+
+	int64_t pos = info->stream->seek(offset, whence);
+	if (pos < info->start)
+		return SDL_SetError("Invalid stream seek");
+
+	return pos - info->start;
+}
+
+static size_t rw_read_func(SDL_RWops *context, void *ptr, size_t size, size_t maxnum) {
+	auto info = static_cast<RWStreamInfo *>(context->hidden.unknown.data1);
+
+	if (size == 0)
+		return 0;
+
+	return info->stream->read(ptr, size * maxnum) / size;
+}
+
+static size_t rw_write_func(SDL_RWops * /*context*/, const void * /*ptr*/, size_t /*size*/, size_t /*num*/) {
+	SDL_SetError("Streams are read-only");
+	return 0;
+}
+
+static int rw_close_func(SDL_RWops *context) {
+	delete static_cast<RWStreamInfo *>(context->hidden.unknown.data1);
+	SDL_FreeRW(context);
+
+	return 0;
+}
+
+static SDL_RWops *RWFromStream(std::unique_ptr<BaseReader::Stream> stream, size_t start = 0) {
+	if (!stream || stream->seek(start, SEEK_SET) < 0)
+		return nullptr;
+
+	SDL_RWops *rw = SDL_AllocRW();
+	if (!rw)
+		return nullptr;
+
+	rw->size                 = rw_size_func;
+	rw->seek                 = rw_seek_func;
+	rw->read                 = rw_read_func;
+	rw->write                = rw_write_func;
+	rw->close                = rw_close_func;
+	rw->type                 = SDL_RWOPS_UNKNOWN;
+	rw->hidden.unknown.data1 = new RWStreamInfo{std::move(stream), static_cast<int64_t>(start)};
+
+	return rw;
 }
 
 void ONScripter::loadSoundIntoCache(int id, const std::string &filename_str, bool async) {
@@ -229,14 +279,21 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 
 	size_t length{0};
 	uint8_t *buffer{nullptr};
-	{
-		Lock lock(&music_file_name);
-		// ------------- ^ ---------------------------------------------------------------------------
-		// ! locked using a different lock to image, make sure all readers can access separate files !
-		// at this moment only DirectReader is reliable
-		// -------------------------------------------------------------------------------------------
-		if (!script_h.reader->getFile(filename, length, &buffer))
+	const uint8_t *view{nullptr};
+	uint8_t stream_header[sizeof(WAVE_HEADER)]{};
+	// Readers are reentrant, no locking is needed to access different files
+	if (!script_h.reader->getFileView(filename, length, &view)) {
+		// Plain music is streamed by the mixer, so it is not read into memory
+		std::unique_ptr<BaseReader::Stream> stream;
+		if (format == SOUND_MUSIC)
+			stream = script_h.reader->openStream(filename);
+		if (stream) {
+			// Just enough data to detect the tags, which are skipped below
+			length = stream->size();
+			stream->read(stream_header, sizeof(stream_header));
+		} else if (!script_h.reader->getFile(filename, length, &buffer)) {
 			return SOUND_NONE;
+		}
 	}
 
 	if (length == 0)
@@ -249,7 +306,14 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 		return SOUND_NONE; //dummy
 	}
 
-	if ((format & SOUND_CHUNK) && !buffer[0] && !buffer[1] && !buffer[2] && !buffer[3]) {
+	if ((format & SOUND_CHUNK) && view && !view[0] && !view[1] && !view[2] && !view[3]) {
+		// the header may get patched in place below, which needs a private copy
+		buffer = new uint8_t[length + 1];
+		std::memcpy(buffer, view, length);
+		view = nullptr;
+	}
+
+	if ((format & SOUND_CHUNK) && !view && !buffer[0] && !buffer[1] && !buffer[2] && !buffer[3]) {
 		// "chunk" sound files would have a 4+ byte magic number,
 		// so this could be a WAV with a bad (encrypted?) header;
 		// will recreate the header from a ".fmt" file if one exists
@@ -260,10 +324,7 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 
 		size_t fmtlen{0};
 		uint8_t *fmtbuffer{nullptr};
-		{
-			Lock lock(&music_file_name);
-			script_h.reader->getFile(fmtname, fmtlen, &fmtbuffer);
-		}
+		script_h.reader->getFile(fmtname, fmtlen, &fmtbuffer);
 
 		if (fmtlen >= 8) {
 			// a file called filename + ".fmt" exists, of appropriate size;
@@ -315,27 +376,38 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 		freearr(&fmtname);
 	}
 
+	// Either points to a memory-mapped archive entry, our own buffer, or the header of a streamed file
+	bool streamed       = !view && !buffer;
+	const uint8_t *data = view ? view : buffer ? buffer : stream_header;
+
 	if (format & SOUND_MUSIC) {
 		int id3v2_size = 0;
-		if (HAS_ID3V2_TAG(buffer)) {
+		if (HAS_ID3V2_TAG(data)) {
 			//found an ID3v2 tag, skipping since SMPEG doesn't
 			for (int i = 0; i < 4; i++) {
-				if (buffer[6 + i] & 0x80) { //err music_buffer brb, sorry {think of it}. See above ^
+				if (data[6 + i] & 0x80) { //err music_buffer brb, sorry {think of it}. See above ^
 					id3v2_size = 0;
 					break;
 				}
 				id3v2_size <<= 7;
-				id3v2_size += buffer[6 + i];
+				id3v2_size += data[6 + i];
 			}
 			if (id3v2_size > 0) {
 				id3v2_size += 10;
 				sendToLog(LogLevel::Info, "found ID3v2 tag in file '%s', size %d bytes\n", filename, id3v2_size);
 			}
 		}
-		uint8_t *m_buf   = buffer + id3v2_size;
-		const long m_len = length - id3v2_size;
+		const uint8_t *m_buf = data + id3v2_size;
+		const long m_len     = length - id3v2_size;
+
+		// Each consumer gets a source of its own, streamed ones are reopened as they have a position
+		auto musicSource = [&]() {
+			if (streamed)
+				return RWFromStream(script_h.reader->openStream(filename), id3v2_size);
+			return SDL_RWFromConstMem(m_buf, static_cast<int>(m_len));
+		};
 
-		Mix_Music *music_info_local = Mix_LoadMUS_RW(SDL_RWFromMem(m_buf, static_cast<int>(m_len)), 0);
+		Mix_Music *music_info_local = Mix_LoadMUS_RW(musicSource(), 1);
 
 		if (music_info_local) {
 			if (match_bgm_audio_flag) {
@@ -348,9 +420,12 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 				bool change_spec     = false;
 
 				if (mtype == MUS_MP3) {
-					SMPEG *mp3_chk = SMPEG_new_rwops(SDL_RWFromMem(m_buf, static_cast<int>(m_len)), nullptr, 0, 0);
-					SMPEG_wantedSpec(mp3_chk, &wanted);
-					SMPEG_delete(mp3_chk);
+					SDL_RWops *mp3_src = musicSource();
+					if (mp3_src) {
+						SMPEG *mp3_chk = SMPEG_new_rwops(mp3_src, nullptr, 1, 0);
+						SMPEG_wantedSpec(mp3_chk, &wanted);
+						SMPEG_delete(mp3_chk);
+					}
 					if ((wanted.freq != audio_format.freq) ||
 					    (wanted.format != audio_format.format))
 						change_spec = true;
@@ -358,16 +433,14 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 
 				if (mtype == MUS_OGG) {
 					OVInfo *ovi = new OVInfo();
-					ovi->buf    = m_buf;
-					ovi->length = m_len;
-					ovi->pos    = 0;
+					ovi->src    = musicSource();
 					//annoying having to set callbacks just to check the specs...
 					ov_callbacks oc;
 					oc.read_func  = oc_read_func;
 					oc.seek_func  = oc_seek_func;
 					oc.close_func = nullptr;
 					oc.tell_func  = oc_tell_func;
-					if (ov_test_callbacks(ovi, &ovi->ovf, nullptr, 0, oc) >= 0) {
+					if (ovi->src && ov_test_callbacks(ovi, &ovi->ovf, nullptr, 0, oc) >= 0) {
 						vorbis_info *vi = ov_info(&ovi->ovf, -1);
 						if (vi) {
 							wanted.channels = vi->channels;
@@ -376,15 +449,22 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 						}
 						ov_clear(&ovi->ovf);
 					}
+					if (ovi->src)
+						SDL_RWclose(ovi->src);
 					delete ovi;
 				}
 
 				if (mtype == MUS_WAV) {
-					WAVE_HEADER *wav_hdr = reinterpret_cast<WAVE_HEADER *>(m_buf);
-					wanted.freq          = wav_hdr->frequency[3];
-					wanted.freq          = (wanted.freq << 8) + wav_hdr->frequency[2];
-					wanted.freq          = (wanted.freq << 8) + wav_hdr->frequency[1];
-					wanted.freq          = (wanted.freq << 8) + wav_hdr->frequency[0];
+					WAVE_HEADER wav_hdr{};
+					SDL_RWops *wav_src = musicSource();
+					if (wav_src) {
+						SDL_RWread(wav_src, &wav_hdr, sizeof(wav_hdr), 1);
+						SDL_RWclose(wav_src);
+					}
+					wanted.freq = wav_hdr.frequency[3];
+					wanted.freq = (wanted.freq << 8) + wav_hdr.frequency[2];
+					wanted.freq = (wanted.freq << 8) + wav_hdr.frequency[1];
+					wanted.freq = (wanted.freq << 8) + wav_hdr.frequency[0];
 				}
 
 				if (!change_spec && (wanted.freq != audio_format.freq)) {
@@ -419,7 +499,7 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 					// !!!! ^^^^^^ old problematic comment spotted ^^^^^ !!!!
 					// -----------------------------------------------------------------------------------
 
-					music_info_local = Mix_LoadMUS_RW(SDL_RWFromMem(buffer + id3v2_size, static_cast<int>(length - id3v2_size)), 0);
+					music_info_local = Mix_LoadMUS_RW(musicSource(), 1);
 				}
 			}
 
@@ -429,7 +509,7 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 				Lock lock(&playSoundThreadedLock);
 				assert(!music_buffer);
 				music_info          = music_info_local;
-				music_buffer        = buffer;
+				music_buffer        = buffer; // nullptr for mapped and streamed files, which outlive the playback
 				music_buffer_length = length;
 				return SOUND_MUSIC;
 			}
@@ -445,7 +525,7 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 	}
 
 	if (format & SOUND_CHUNK) {
-		Mix_Chunk *chunk = Mix_LoadWAV_RW(SDL_RWFromMem(buffer, static_cast<int>(length)), 1);
+		Mix_Chunk *chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data, static_cast<int>(length)), 1);
 		if (!chunk) {
 			char errBuf[MAX_ERRBUF_LEN];
 			std::snprintf(errBuf, MAX_ERRBUF_LEN, "error playing sound '%s': %s\n", filename, Mix_GetError());
@@ -483,7 +563,7 @@ int ONScripter::playSound(const char *filename, int format, bool loop_flag, int
 		} else {
 			{
 				Lock lock(&music_file_name);
-				if (std::fwrite(buffer, 1, length, fp) != length) {
+				if (std::fwrite(data, 1, length, fp) != length) {
 					char errBuf[MAX_ERRBUF_LEN];
 					std::snprintf(errBuf, MAX_ERRBUF_LEN,
 					              "can't write to temporary music file %s",
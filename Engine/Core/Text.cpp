@@ -513,30 +513,148 @@ bool ONScripter::processIgnored(std::u16string &string, Fontinfo &info) {
 	return false;
 }
 
-void ONScripter::resetGlyphCache() {
+void ONScripter::cacheGlyph(const GlyphParams &key, GlyphValues *glyph) {
+	glyphCache.set(key, glyph);
+	if (use_text_atlas) {
+		if (glyph->glyph_pos.has())
+			glyphAtlasPageKeys[glyph->glyph_page].push_back(key);
+		if (glyph->border_pos.has() && (!glyph->glyph_pos.has() || glyph->border_page != glyph->glyph_page))
+			glyphAtlasPageKeys[glyph->border_page].push_back(key);
+	}
+}
+
+void ONScripter::evictGlyphAtlasPage() {
 	if (!use_text_atlas) {
-		throw std::runtime_error("Attempted to reset disabled text atlas");
+		throw std::runtime_error("Attempted to evict disabled text atlas");
+	}
+
+	uint32_t page;
+	if (!glyphAtlas.evict(page)) {
+		throw std::runtime_error("Glyph does not fit into an empty text atlas page");
+	}
+
+	// Only the glyphs placed on this page are dropped, the entry may have been evicted or replaced since it was recorded
+	auto &keys = glyphAtlasPageKeys[page];
+	for (auto &key : keys) {
+		auto glyph = glyphCache.get(key);
+		if (glyph && ((glyph->glyph_pos.has() && glyph->glyph_page == page) ||
+		              (glyph->border_pos.has() && glyph->border_page == page)))
+			glyphCache.remove(key);
+	}
+	keys.clear();
+}
+
+void ONScripter::prerenderPresetGlyphs() {
+	auto charset = ons_cfg_options.find("glyph-charset");
+	if (charset == ons_cfg_options.end() || use_distance_field_glyphs)
+		return; // distance fields are shared by every preset and cheap to render on demand
+
+	// Presets sharing a font, size and style share their glyphs
+	std::vector<GlyphParams> keys;
+	std::vector<int> keyPresets;
+	GlyphParamsEqual equal;
+	for (auto &preset : presets) {
+		auto &style = preset.second;
+		if (style.font_size <= 0 || (style.is_border && style.border_width < 0))
+			continue; // inherited from the surrounding text, unknown in advance
+
+		GlyphParams key{};
+		key.font_number  = style.font_number;
+		key.preset_id    = fonts.glyphStorageOptimisation ? -1 : style.preset_id;
+		key.font_size    = style.font_size;
+		key.border_width = style.is_border ? style.border_width : 0;
+		key.is_bold      = style.is_bold;
+		key.is_italic    = style.is_italic;
+		key.is_border    = style.is_border;
+		key.is_colored   = false;
+
+		if (std::any_of(keys.begin(), keys.end(), [&](const GlyphParams &other) { return equal(key, other); }))
+			continue;
+		keys.emplace_back(key);
+		keyPresets.emplace_back(style.preset_id);
+	}
+
+	// reset runs this again, the glyphs of the same presets are already in glyphCache by then
+	bool same = charset->second == prerenderedCharset && keys.size() == prerenderedPresetKeys.size() &&
+	            std::equal(keys.begin(), keys.end(), prerenderedPresetKeys.begin(), equal);
+	if (same || keys.empty())
+		return;
+	prerenderedCharset    = charset->second;
+	prerenderedPresetKeys = keys;
+	fonts.dropPrerenderedGlyphs(); // glyphs of the previous presets that were never drawn
+
+	std::vector<uint8_t> buffer;
+	size_t length{0};
+	if (!script_h.reader->getFile(charset->second.c_str(), length, buffer)) {
+		sendToLog(LogLevel::Error, "Failed to read glyph charset %s\n", charset->second.c_str());
+		return;
 	}
 
-	sendToLog(LogLevel::Warn, "Resetting glyph cache will cause degraded performance!\n");
-	glyphAtlas.reset();
-	auto sz = glyphCache.size();
-	glyphCache.resize(0);
-	glyphCache.resize(sz);
+	// The file order is kept, so the characters listed first are the ones rasterised when the budget runs out
+	std::vector<uint32_t> codepoints;
+	std::unordered_set<uint32_t> seen;
+	uint32_t state{0}, codepoint{0};
+	for (size_t i = 0; i < length; i++) {
+		auto res = decodeUTF8(&state, &codepoint, buffer[i]);
+		if (res == 0 && codepoint > 0x20 && seen.insert(codepoint).second)
+			codepoints.emplace_back(codepoint);
+		else if (res == 1) // rejected sequence
+			state = 0;
+	}
+
+	// Prerendered glyphs wait in memory until drawn, keep no more of them than the default glyphCache holds
+	// (textatlas makes glyphCache itself virtually unbounded)
+	size_t budget = NUM_GLYPH_CACHE;
+	for (size_t i = 0; i < keys.size() && budget > 0 && !codepoints.empty(); i++) {
+		size_t count = std::min(budget, codepoints.size());
+		budget -= count;
+		async.prerenderGlyphs(keys[i], keyPresets[i], std::vector<uint32_t>(codepoints.begin(), codepoints.begin() + count));
+	}
 }
 
 void ONScripter::renderGlyphValues(const GlyphValues &values, GPU_Rect *dst_clip, TextRenderingState::TextRenderingDst dst, float x, float y, float r, bool render_border, int alpha) {
 	GPU_Image *coloured_glyph{nullptr};
 	GPU_Rect *src_rect{nullptr};
-	if ((!render_border && values.glyph_pos.has()) || (render_border && values.border_pos.has())) {
+	// Distance field borders come from the glyph field itself
+	bool border_image = render_border && values.sdf_scale == 0;
+	if ((!border_image && values.glyph_pos.has()) || (border_image && values.border_pos.has())) {
 		// new approach goes here
-		coloured_glyph = glyphAtlas.atlas;
-		src_rect       = render_border ? &values.border_pos.get() : &values.glyph_pos.get();
+		auto page      = border_image ? values.border_page : values.glyph_page;
+		coloured_glyph = glyphAtlas.image(page);
+		src_rect       = border_image ? &values.border_pos.get() : &values.glyph_pos.get();
+		glyphAtlas.touch(page);
 	} else {
-		coloured_glyph = render_border ? values.border_gpu : values.glyph_gpu;
+		coloured_glyph = border_image ? values.border_gpu : values.glyph_gpu;
 	}
 
-	if (coloured_glyph) {
+	if (coloured_glyph && values.sdf_scale > 0) {
+		if (render_border && values.sdf_border <= 0)
+			return;
+
+		// Atlas rectangles keep a pixel of margin around the field
+		float s      = values.sdf_scale;
+		float margin = src_rect ? 1 : 0;
+		float range  = s * 2 * GlyphDistanceFieldSpread;
+		x += r * (values.sdf_offset_x + s * ((src_rect ? src_rect->w : coloured_glyph->w) / 2.0 - margin));
+		y += values.sdf_offset_y + s * ((src_rect ? src_rect->h : coloured_glyph->h) / 2.0 - margin);
+
+		gpu.setShaderProgram("glyphDistanceField.frag");
+		gpu.bindImageToSlot(coloured_glyph, 0);
+		gpu.setShaderVar("glyphColor", render_border ? values.sdf_border_color : values.sdf_color);
+		gpu.setShaderVar("smoothing", std::min(0.5f, 0.7f / range));
+		gpu.setShaderVar("outline", render_border ? values.sdf_border / range : 0.0f);
+		if (alpha < 255) {
+			GPU_SetRGBA(coloured_glyph, alpha, alpha, alpha, alpha);
+		}
+		if (dst.target)
+			gpu.copyGPUImage(coloured_glyph, src_rect, dst_clip, dst.target, x, y, r * s, s, 0, true);
+		else
+			gpu.copyGPUImage(coloured_glyph, src_rect, dst_clip, dst.bigImage, x, y, r * s, s);
+		if (alpha < 255) {
+			GPU_SetRGBA(coloured_glyph, 255, 255, 255, 255);
+		}
+		gpu.unsetShaderProgram();
+	} else if (coloured_glyph) {
 		x += r * (src_rect ? src_rect->w : coloured_glyph->w) / 2.0;
 		y += 1 * (src_rect ? src_rect->h : coloured_glyph->h) / 2.0;
 		if (alpha < 255) {
@@ -560,27 +678,36 @@ void ONScripter::renderGlyphValues(const GlyphValues &values, GPU_Rect *dst_clip
 const GlyphValues *ONScripter::renderUnicodeGlyph(Font *font, GlyphParams *key) {
 	static SDL_Color fcol = {0xff, 0xff, 0xff, 0xff}, bcol = {0, 0, 0, 0};
 
+	if (use_distance_field_glyphs && !(key->is_colored && key->is_gradient)) {
+		auto glyph = renderDistanceFieldGlyph(font, key);
+		if (glyph)
+			return glyph;
+	}
+
 	GlyphParams k = *key;
 
-	GlyphValues *glyph;
-	try {
-		glyph = glyphCache.get(k);
-	} catch (int) {
+	// Glyphs larger than an empty atlas page keep their own textures, evicting pages would never make room for them
+	auto atlasFor = [this](const GlyphValues *glyph) {
+		return use_text_atlas && glyph->fitsAtlas(glyphAtlas) ? &glyphAtlas : nullptr;
+	};
+
+	GlyphValues *glyph = glyphCache.get(k);
+	if (!glyph) {
 		// No coloured glyph found... we'll have to get an uncolored one and color it.
 		// First let's see if there's an uncolored one already in the cache.
-		GlyphParams uncolored = k;
-		uncolored.is_colored  = false;
-		GlyphValues *uncolored_glyph;
-		try {
-			uncolored_glyph = glyphCache.get(uncolored);
-		} catch (int) {
-			// No uncoloured one in the cache either. Looks like we gotta render it from FT. (Then put it in the cache for later use.)
-			uncolored_glyph = font->renderGlyph(&uncolored, fcol, bcol);
-			if (uncolored_glyph->buildGPUImages(use_text_atlas ? &glyphAtlas : nullptr)) {
-				glyphCache.set(uncolored, uncolored_glyph);
+		GlyphParams uncolored        = k;
+		uncolored.is_colored         = false;
+		GlyphValues *uncolored_glyph = glyphCache.get(uncolored);
+		if (!uncolored_glyph) {
+			// No uncoloured one in the cache either. Looks like we gotta render it from FT unless it was prerendered. (Then put it in the cache for later use.)
+			uncolored_glyph = fonts.takePrerenderedGlyph(uncolored);
+			if (!uncolored_glyph)
+				uncolored_glyph = font->renderGlyph(&uncolored, fcol, bcol);
+			if (uncolored_glyph->buildGPUImages(atlasFor(uncolored_glyph))) {
+				cacheGlyph(uncolored, uncolored_glyph);
 			} else {
 				delete uncolored_glyph;
-				resetGlyphCache();
+				evictGlyphAtlasPage();
 				return renderUnicodeGlyph(font, key);
 			}
 		}
@@ -591,17 +718,18 @@ const GlyphValues *ONScripter::renderUnicodeGlyph(Font *font, GlyphParams *key)
 		if (black_glyph && black_border) {
 			return uncolored_glyph;
 		}
-		bool should_set = true;
-		glyph           = new GlyphValues(*uncolored_glyph); // so we don't ruin the uncolored one in the cache (prevents trying to recolor an already colored glyph)
+		bool should_set                   = true;
+		GlyphAtlasController *color_atlas = atlasFor(uncolored_glyph);
+		glyph                             = new GlyphValues(*uncolored_glyph); // so we don't ruin the uncolored one in the cache (prevents trying to recolor an already colored glyph)
 		if (!black_glyph)
-			should_set = colorGlyph(key, glyph, &k.glyph_color, false, use_text_atlas ? &glyphAtlas : nullptr); // Color the glyph
+			should_set = colorGlyph(key, glyph, &k.glyph_color, false, color_atlas); // Color the glyph
 		if (!black_border && should_set)
-			should_set = colorGlyph(key, glyph, &k.border_color, true, use_text_atlas ? &glyphAtlas : nullptr); // Color the border
+			should_set = colorGlyph(key, glyph, &k.border_color, true, color_atlas); // Color the border
 		if (should_set) {
-			glyphCache.set(k, glyph); // Store the colored glyph in the cache so we don't need to color it repeatedly.
+			cacheGlyph(k, glyph); // Store the colored glyph in the cache so we don't need to color it repeatedly.
 		} else {
 			delete glyph;
-			resetGlyphCache();
+			evictGlyphAtlasPage();
 			return renderUnicodeGlyph(font, key);
 		}
 	}
@@ -609,12 +737,72 @@ const GlyphValues *ONScripter::renderUnicodeGlyph(Font *font, GlyphParams *key)
 	return glyph;
 }
 
+const GlyphValues *ONScripter::renderDistanceFieldGlyph(Font *font, GlyphParams *key) {
+	GlyphParams k = *key;
+
+	GlyphValues *glyph = glyphCache.get(k);
+	if (glyph)
+		return glyph;
+
+	// Same stroke radius as Font::renderGlyph, in screen pixels
+	float scale  = static_cast<float>(font->size()) / GlyphDistanceFieldSize;
+	float border = k.is_border ? k.border_width * fonts.getMultiplier(k.font_number, k.preset_id) / 64.0 : 0;
+	// The field only reaches GlyphDistanceFieldSpread reference pixels past the outline, wider borders use bitmaps
+	if (border >= GlyphDistanceFieldSpread * scale)
+		return nullptr;
+
+	// All sizes, borders and colours of a codepoint share one field, the negative size keeps it apart from real glyphs
+	GlyphParams field_key  = k;
+	field_key.font_size    = -GlyphDistanceFieldSize;
+	field_key.border_width = 0;
+	field_key.is_underline = false;
+	field_key.is_border    = false;
+	field_key.is_colored   = false;
+	field_key.is_gradient  = false;
+
+	GlyphValues *field = glyphCache.get(field_key);
+	if (!field) {
+		field = font->renderDistanceField(&field_key);
+		if (field->buildGPUImages(use_text_atlas ? &glyphAtlas : nullptr)) {
+			cacheGlyph(field_key, field);
+		} else {
+			delete field;
+			evictGlyphAtlasPage();
+			return renderDistanceFieldGlyph(font, key);
+		}
+	}
+
+	// Layout uses the metrics of the requested size, so the text flows exactly as with bitmap glyphs
+	const GlyphValues *measured = measureUnicodeGlyph(font, &k);
+
+	// The field lives in the atlas (see gameCommand), so the copy only shares its rectangle
+	glyph                       = new GlyphValues(*field);
+	glyph->sdf_scale            = scale;
+	glyph->sdf_offset_x         = scale * (field->minx + field->sdf_offset_x) - measured->minx;
+	glyph->sdf_offset_y         = measured->maxy + scale * (field->sdf_offset_y - field->maxy);
+	glyph->border_bitmap_offset = {0, 0};
+	glyph->minx                 = measured->minx;
+	glyph->maxx                 = measured->maxx;
+	glyph->miny                 = measured->miny;
+	glyph->maxy                 = measured->maxy;
+	glyph->advance              = measured->advance;
+	glyph->faceAscender         = measured->faceAscender;
+	glyph->faceDescender        = measured->faceDescender;
+	glyph->ftCharIndexCache     = measured->ftCharIndexCache;
+	glyph->sdf_border           = border;
+	if (k.is_colored) {
+		glyph->sdf_color        = k.glyph_color;
+		glyph->sdf_border_color = k.border_color;
+	}
+
+	cacheGlyph(k, glyph);
+	return glyph;
+}
+
 const GlyphValues *ONScripter::measureUnicodeGlyph(Font *font, GlyphParams *key) {
 	GlyphParams k = *key;
-	GlyphValues *glyph;
-	try {
-		glyph = glyphMeasureCache.get(k);
-	} catch (int) {
+	GlyphValues *glyph = glyphMeasureCache.get(k);
+	if (!glyph) {
 		glyph = font->measureGlyph(&k);
 		glyphMeasureCache.set(k, glyph);
 	}
@@ -12,12 +12,14 @@
 #include "Engine/Graphics/Common.hpp"
 #include "Engine/Core/ONScripter.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <stack>
 #include <string>
 #include <sstream>
 #include <unordered_map>
+#include <vector>
 
 #define FT_CEIL(X) ((((X) + 63) & -64) / 64)
 
@@ -192,6 +194,22 @@ const char *Fontinfo::getFontPath(unsigned int i) {
 
 // Font code
 
+bool Font::openCopy(FT_Library library, const Font &orig) {
+	if (!orig.loaded || fonts.openFace(library, orig.path.get(), 0, &normal_face))
+		return false;
+	face = normal_face;
+
+	if (orig.hasInternalBoldFace)
+		hasInternalBoldFace = !fonts.openFace(library, orig.path.get(), orig.bold_face->face_index, &bold_face);
+	if (orig.hasInternalItalicFace)
+		hasInternalItalicFace = !fonts.openFace(library, orig.path.get(), orig.italic_face->face_index, &italic_face);
+	if (orig.hasInternalBoldItalicFace)
+		hasInternalBoldItalicFace = !fonts.openFace(library, orig.path.get(), orig.bold_italic_face->face_index, &bold_italic_face);
+
+	loaded = true;
+	return true;
+}
+
 GlyphValues *Font::measureGlyph(GlyphParams *key) {
 	//    ons.printClock("measureGlyph");
 	GlyphValues *rv = new GlyphValues;
@@ -313,6 +331,116 @@ GlyphValues *Font::renderGlyph(GlyphParams *key, SDL_Color fg, SDL_Color bg) {
 	return rv;
 }
 
+// Felzenszwalb-Huttenlocher squared distance transform, applied along one row or column of the grid
+static void distanceTransform(std::vector<double> &grid, size_t offset, size_t stride, int n,
+                              std::vector<double> &f, std::vector<int> &v, std::vector<double> &z) {
+	const double inf = 1e20;
+
+	for (int q = 0; q < n; q++)
+		f[q] = grid[offset + q * stride];
+
+	int k = 0;
+	v[0]  = 0;
+	z[0]  = -inf;
+	z[1]  = inf;
+	for (int q = 1; q < n; q++) {
+		double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+		while (s <= z[k]) {
+			k--;
+			s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+		}
+		k++;
+		v[k]     = q;
+		z[k]     = s;
+		z[k + 1] = inf;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; q++) {
+		while (z[k + 1] < q)
+			k++;
+		grid[offset + q * stride] = (q - v[k]) * (q - v[k]) + f[v[k]];
+	}
+}
+
+// Distances from every pixel to the closest pixel marked with 0, the grid is in squared pixels afterwards
+static void distanceTransform(std::vector<double> &grid, int w, int h) {
+	int n = std::max(w, h);
+	std::vector<double> f(n), z(n + 1);
+	std::vector<int> v(n);
+
+	for (int x = 0; x < w; x++)
+		distanceTransform(grid, x, w, h, f, v, z);
+	for (int y = 0; y < h; y++)
+		distanceTransform(grid, static_cast<size_t>(y) * w, 1, w, f, v, z);
+}
+
+GlyphValues *Font::renderDistanceField(GlyphParams *key) {
+	GlyphValues *rv = new GlyphValues;
+
+	// Only the rasterisation happens at the reference size, kerning and measuring keep using the requested one
+	err = FT_Set_Char_Size(face, 0, static_cast<FT_F26Dot6>(GlyphDistanceFieldSize) * 64, 0, 0);
+
+	FT_GlyphSlot glyph = err ? nullptr : loadGlyph(key->unicode, rv->ftCharIndexCache);
+	FT_Glyph actual_glyph{nullptr};
+	if (!err)
+		err = FT_Get_Glyph(glyph, &actual_glyph);
+	if (!err && actual_glyph->format != FT_GLYPH_FORMAT_BITMAP)
+		err = FT_Glyph_To_Bitmap(&actual_glyph, FT_RENDER_MODE_NORMAL, nullptr, 1);
+
+	if (!err) {
+		auto bmp_glyph = reinterpret_cast<FT_BitmapGlyph>(actual_glyph);
+		auto &bitmap   = bmp_glyph->bitmap;
+		int spread     = GlyphDistanceFieldSpread;
+		int w          = bitmap.width ? static_cast<int>(bitmap.width) + spread * 2 : 0;
+		int h          = bitmap.rows ? static_cast<int>(bitmap.rows) + spread * 2 : 0;
+
+		// Pixels at least half covered are inside the outline
+		std::vector<double> outside(static_cast<size_t>(w) * h, 0), inside(static_cast<size_t>(w) * h, 1e20);
+		for (unsigned int row = 0; row < bitmap.rows; row++) {
+			for (unsigned int col = 0; col < bitmap.width; col++) {
+				if (bitmap.buffer[row * bitmap.pitch + col] >= 0x80) {
+					size_t i   = (row + spread) * w + col + spread;
+					outside[i] = 1e20;
+					inside[i]  = 0;
+				}
+			}
+		}
+		distanceTransform(outside, w, h);
+		distanceTransform(inside, w, h);
+
+		// 0x80 lies on the outline, the spread maps to the whole byte range
+		rv->bitmap = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 8, 0, 0, 0, 0);
+		for (int y = 0; y < h; y++) {
+			uint8_t *dst = static_cast<uint8_t *>(rv->bitmap->pixels) + y * rv->bitmap->pitch;
+			for (int x = 0; x < w; x++) {
+				size_t i = static_cast<size_t>(y) * w + x;
+				double d = inside[i] == 0 ? std::sqrt(outside[i]) - 0.5 : 0.5 - std::sqrt(inside[i]);
+				double a = 0.5 + d / (2.0 * spread);
+				dst[x]   = static_cast<uint8_t>(std::lround(std::min(1.0, std::max(0.0, a)) * 255));
+			}
+		}
+
+		rv->sdf_offset_x  = -spread;
+		rv->sdf_offset_y  = -spread;
+		rv->minx          = bmp_glyph->left;
+		rv->maxy          = bmp_glyph->top;
+		rv->miny          = bmp_glyph->top - static_cast<int>(bitmap.rows);
+		rv->maxx          = bmp_glyph->left + static_cast<int>(bitmap.width);
+		rv->advance       = (actual_glyph->advance.x / 65536.0);
+		rv->faceAscender  = (face->size->metrics.ascender / 64.0);
+		rv->faceDescender = -(face->size->metrics.descender / 64.0); // make both positive
+	}
+
+	if (actual_glyph)
+		FT_Done_Glyph(actual_glyph);
+
+	if (current_size > 0)
+		FT_Set_Char_Size(face, 0, static_cast<FT_F26Dot6>(current_size) * 64, 0, 0);
+
+	return rv;
+}
+
 SDL_Surface *Font::freetypeToSDLSurface(FT_Bitmap *ft_bmp, SDL_Color fg, SDL_Color bg) {
 	SDL_Surface *sdl_surface = SDL_CreateRGBSurface(SDL_SWSURFACE, ft_bmp->width, ft_bmp->rows, 8, 0, 0, 0, 0);
 
@@ -345,7 +473,8 @@ SDL_Surface *Font::freetypeToSDLSurface(FT_Bitmap *ft_bmp, SDL_Color fg, SDL_Col
 void Font::drawBorder(FT_Glyph *glyph, int border) {
 
 	FT_Stroker stroker;
-	err = FT_Stroker_New(fonts.freetype, &stroker);
+	// The glyph library may be a background rasterisation one
+	err = FT_Stroker_New((*glyph)->library, &stroker);
 	if (err) {
 		//sendToLog(LogLevel::Error, "FT_Stroker failed\n");
 		FT_Stroker_Done(stroker);
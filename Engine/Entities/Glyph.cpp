@@ -12,6 +12,8 @@
 #include "Engine/Components/GlyphAtlas.hpp"
 #include "Support/FileDefs.hpp"
 
+#include <algorithm>
+
 GlyphValues::GlyphValues(const GlyphValues &orig) {
 	if (!orig.glyph_gpu || orig.glyph_gpu->w == 0 || orig.glyph_gpu->h == 0)
 		glyph_gpu = nullptr;
@@ -47,8 +49,17 @@ GlyphValues::GlyphValues(const GlyphValues &orig) {
 	faceAscender  = orig.faceAscender;
 	faceDescender = orig.faceDescender;
 
-	glyph_pos  = orig.glyph_pos;
-	border_pos = orig.border_pos;
+	glyph_pos   = orig.glyph_pos;
+	border_pos  = orig.border_pos;
+	glyph_page  = orig.glyph_page;
+	border_page = orig.border_page;
+
+	sdf_scale        = orig.sdf_scale;
+	sdf_offset_x     = orig.sdf_offset_x;
+	sdf_offset_y     = orig.sdf_offset_y;
+	sdf_border       = orig.sdf_border;
+	sdf_color        = orig.sdf_color;
+	sdf_border_color = orig.sdf_border_color;
 }
 
 GlyphValues::~GlyphValues() {
@@ -69,6 +80,12 @@ bool GlyphValues::buildGPUImages(GlyphAtlasController *atlas) {
 	return ret;
 }
 
+bool GlyphValues::fitsAtlas(const GlyphAtlasController &atlas) const {
+	// buildGPUImage keeps a 1 px margin around every image
+	return (!bitmap || atlas.fits(bitmap->w + 2, bitmap->h + 2)) &&
+	       (!border_bitmap || atlas.fits(border_bitmap->w + 2, border_bitmap->h + 2));
+}
+
 bool GlyphValues::buildGPUImage(bool border, GlyphAtlasController *atlas) {
 
 	SDL_Surface *src_surface = border ? border_bitmap : bitmap;
@@ -106,14 +123,18 @@ bool GlyphValues::buildGPUImage(bool border, GlyphAtlasController *atlas) {
 
 	if (atlas) {
 		GPU_Rect rect;
-		if (atlas->add(img->w + 2, img->h + 2, rect)) {
+		uint32_t page;
+		if (atlas->add(img->w + 2, img->h + 2, rect, page)) {
 
-			gpu.copyGPUImage(img, nullptr, &rect, atlas->atlas->target, rect.x + 1, rect.y + 1);
-			gpu.simulateRead(atlas->atlas);
-			if (border)
+			gpu.copyGPUImage(img, nullptr, &rect, atlas->image(page)->target, rect.x + 1, rect.y + 1);
+			gpu.simulateRead(atlas->image(page));
+			if (border) {
 				border_pos.set(rect);
-			else
+				border_page = page;
+			} else {
 				glyph_pos.set(rect);
+				glyph_page = page;
+			}
 		} else {
 			sendToLog(LogLevel::Error, "GlyphValues@buildGPUImage: Texture atlas addition failed!\n");
 			ret = false;
@@ -126,3 +147,163 @@ bool GlyphValues::buildGPUImage(bool border, GlyphAtlasController *atlas) {
 
 	return ret;
 }
+
+static inline uint64_t mixGlyphBits(uint64_t h) {
+	// murmur3 64-bit finaliser
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+uint64_t hashGlyphParams(const GlyphParams &gp) {
+	uint64_t base  = gp.unicode | static_cast<uint64_t>(gp.font_number) << 32;
+	uint64_t sizes = static_cast<uint32_t>(gp.font_size) | static_cast<uint64_t>(static_cast<uint32_t>(gp.border_width)) << 32;
+	uint64_t style = static_cast<uint64_t>(gp.is_bold) | static_cast<uint64_t>(gp.is_italic) << 1 |
+	                 static_cast<uint64_t>(gp.is_underline) << 2 | static_cast<uint64_t>(gp.is_border) << 3;
+
+	// Same rule as GlyphParamsEqual: black coloured glyphs match uncoloured ones
+	bool no_color = !gp.is_colored || (gp.glyph_color.r == 0 && gp.glyph_color.g == 0 && gp.glyph_color.b == 0 &&
+	                                   gp.border_color.r == 0 && gp.border_color.g == 0 && gp.border_color.b == 0);
+	if (!no_color) {
+		style |= 1 << 4 | static_cast<uint64_t>(gp.is_gradient) << 5 |
+		         static_cast<uint64_t>(gp.glyph_color.r) << 8 | static_cast<uint64_t>(gp.glyph_color.g) << 16 |
+		         static_cast<uint64_t>(gp.glyph_color.b) << 24 | static_cast<uint64_t>(gp.border_color.r) << 32 |
+		         static_cast<uint64_t>(gp.border_color.g) << 40 | static_cast<uint64_t>(gp.border_color.b) << 48;
+	}
+
+	return mixGlyphBits(mixGlyphBits(mixGlyphBits(base) ^ sizes) ^ style);
+}
+
+static inline uint64_t glyphCacheHash(const GlyphParams &key) {
+	auto hash = hashGlyphParams(key);
+	return hash ? hash : 1;
+}
+
+size_t GlyphCache::find(const GlyphParams &key, uint64_t hash) const {
+	if (hashes.empty())
+		return SIZE_MAX;
+	GlyphParamsEqual equal;
+	for (size_t index = hash & mask; hashes[index]; index = (index + 1) & mask) {
+		if (hashes[index] == hash && equal(entries[index].key, key))
+			return index;
+	}
+	return SIZE_MAX;
+}
+
+void GlyphCache::erase(size_t index) {
+	// Backward shift deletion keeps every probe sequence intact without tombstones
+	size_t hole = index;
+	for (size_t next = (index + 1) & mask; hashes[next]; next = (next + 1) & mask) {
+		size_t home = hashes[next] & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			hashes[hole]     = hashes[next];
+			entries[hole]    = entries[next];
+			referenced[hole] = referenced[next];
+			hole             = next;
+		}
+	}
+	hashes[hole]     = 0;
+	entries[hole]    = Entry{};
+	referenced[hole] = 0;
+	count--;
+}
+
+void GlyphCache::evict() {
+	while (true) {
+		hand &= mask;
+		if (hashes[hand]) {
+			if (!referenced[hand]) {
+				delete entries[hand].value;
+				erase(hand);
+				return;
+			}
+			referenced[hand] = 0;
+		}
+		hand++;
+	}
+}
+
+void GlyphCache::grow() {
+	std::vector<uint64_t> oldHashes(std::max<size_t>(hashes.size() * 2, 64), 0);
+	std::vector<Entry> oldEntries(oldHashes.size());
+	std::vector<uint8_t> oldReferenced(oldHashes.size(), 0);
+	std::swap(hashes, oldHashes);
+	std::swap(entries, oldEntries);
+	std::swap(referenced, oldReferenced);
+	mask = hashes.size() - 1;
+	hand = 0;
+
+	for (size_t i = 0; i < oldHashes.size(); i++) {
+		if (!oldHashes[i])
+			continue;
+		size_t index = oldHashes[i] & mask;
+		while (hashes[index]) index = (index + 1) & mask;
+		hashes[index]     = oldHashes[i];
+		entries[index]    = oldEntries[i];
+		referenced[index] = oldReferenced[i];
+	}
+}
+
+GlyphValues *GlyphCache::get(const GlyphParams &key) {
+	lookups++;
+	auto index = find(key, glyphCacheHash(key));
+	if (index == SIZE_MAX)
+		return nullptr;
+	referenced[index] = 1;
+	return entries[index].value;
+}
+
+void GlyphCache::set(const GlyphParams &key, GlyphValues *value) {
+	// Setting the capacity to 0 will disable the cache.
+	if (capacity == 0)
+		return;
+
+	auto hash  = glyphCacheHash(key);
+	auto index = find(key, hash);
+	if (index != SIZE_MAX) {
+		if (entries[index].value != value)
+			delete entries[index].value;
+		entries[index].value = value;
+		referenced[index]    = 1;
+		return;
+	}
+
+	if (count >= capacity)
+		evict();
+	if ((count + 1) * 2 > hashes.size())
+		grow();
+
+	index = hash & mask;
+	while (hashes[index]) index = (index + 1) & mask;
+	hashes[index]     = hash;
+	entries[index]    = Entry{key, value};
+	referenced[index] = 1;
+	count++;
+}
+
+void GlyphCache::remove(const GlyphParams &key) {
+	auto index = find(key, glyphCacheHash(key));
+	if (index == SIZE_MAX)
+		return;
+	delete entries[index].value;
+	erase(index);
+}
+
+void GlyphCache::resize(size_t cap) {
+	while (count > cap) evict();
+	capacity = cap;
+}
+
+void GlyphCache::clear() {
+	for (size_t i = 0; i < hashes.size(); i++) {
+		if (hashes[i])
+			delete entries[i].value;
+	}
+	hashes.clear();
+	entries.clear();
+	referenced.clear();
+	count = hand = mask = 0;
+}
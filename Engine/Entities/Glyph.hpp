@@ -14,10 +14,16 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_gpu.h>
 
+#include <vector>
 #include <cstdint>
 
 class GlyphAtlasController;
 
+// Distance field glyphs are rasterised once at this pixel size and scaled by the shader
+const int GlyphDistanceFieldSize{64};
+// Distance in reference pixels covered by the field on each side of the outline, also the bitmap padding
+const int GlyphDistanceFieldSpread{8};
+
 //Key params of our Font cache
 struct GlyphParams {
 	uint32_t unicode;
@@ -50,6 +56,13 @@ public:
 	SDL_Point border_bitmap_offset{0, 0};
 	cmp::optional<GPU_Rect> glyph_pos;
 	cmp::optional<GPU_Rect> border_pos;
+	uint32_t glyph_page{0}, border_page{0};
+
+	// Distance field glyphs share one reference bitmap, sdf_scale maps it to the requested size and
+	// sdf_offset places its padded top left corner relative to the usual blit position
+	float sdf_scale{0}, sdf_offset_x{0}, sdf_offset_y{0}, sdf_border{0};
+	SDL_Color sdf_color{0, 0, 0, 0xFF};
+	SDL_Color sdf_border_color{0, 0, 0, 0xFF};
 
 	//I don't like having this block here, but a unified Glyph class is worth it
 	float minx{0}, maxx{0}, miny{0}, maxy{0}, advance{0}, faceAscender{0}, faceDescender{0};
@@ -57,17 +70,19 @@ public:
 
 	bool buildGPUImage(bool border = false, GlyphAtlasController *atlas = nullptr);
 	bool buildGPUImages(GlyphAtlasController *atlas = nullptr);
+	bool fitsAtlas(const GlyphAtlasController &atlas) const;
 	GlyphValues() = default;
 	GlyphValues(const GlyphValues &orig);
 	GlyphValues &operator=(const GlyphValues &) = delete;
 	~GlyphValues();
 };
 
+// Mixes every field compared by GlyphParamsEqual, colours only count for coloured glyphs
+uint64_t hashGlyphParams(const GlyphParams &gp);
+
 struct GlyphParamsHash {
 	size_t operator()(const GlyphParams &gp) const {
-		return gp.font_number ^ (static_cast<size_t>(gp.font_size) << 4) ^ (static_cast<size_t>(gp.unicode) << 10) ^
-		       (static_cast<size_t>(gp.is_bold) << 20) ^ (static_cast<size_t>(gp.is_italic) << 21) ^ (static_cast<size_t>(gp.is_underline) << 22) ^
-		       (static_cast<size_t>(gp.is_border) << 23) ^ (static_cast<size_t>(gp.is_colored) << 24) ^ (static_cast<size_t>(gp.is_gradient) << 25);
+		return static_cast<size_t>(hashGlyphParams(gp));
 	}
 };
 
@@ -105,3 +120,51 @@ struct GlyphParamsEqual {
 		return (left_no_color && right_no_color) || color_equal;
 	}
 };
+
+// Glyph cache with open addressing over a flat table and CLOCK eviction, owns the stored values.
+// Each slot keeps the 64-bit key hash next to a reference bit, so probes rarely compare whole params.
+class GlyphCache {
+	struct Entry {
+		GlyphParams key;
+		GlyphValues *value;
+	};
+
+	std::vector<uint64_t> hashes; // 0 marks an empty slot
+	std::vector<Entry> entries;
+	std::vector<uint8_t> referenced;
+	size_t capacity;
+	size_t count{0};
+	size_t hand{0};
+	size_t mask{0};
+	size_t lookups{0};
+
+	size_t find(const GlyphParams &key, uint64_t hash) const;
+	void erase(size_t index);
+	void evict();
+	void grow();
+
+public:
+	explicit GlyphCache(size_t capacity)
+	    : capacity(capacity) {}
+	GlyphCache(const GlyphCache &) = delete;
+	GlyphCache &operator=(const GlyphCache &) = delete;
+	~GlyphCache() {
+		clear();
+	}
+
+	// Returns nullptr when the glyph is not cached
+	GlyphValues *get(const GlyphParams &key);
+	void set(const GlyphParams &key, GlyphValues *value);
+	void remove(const GlyphParams &key);
+	void resize(size_t cap);
+	void clear();
+
+	size_t size() const {
+		return capacity;
+	}
+	size_t takeLookups() {
+		auto ret = lookups;
+		lookups  = 0;
+		return ret;
+	}
+};
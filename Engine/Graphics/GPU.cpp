@@ -550,7 +550,7 @@ void GPUController::copyGPUImage(GPU_Image *img, GPU_Rect *src_rect, GPU_Rect *c
 	// printClock("end copyGPUImage");
 }
 
-void GPUController::copyGPUImage(GPU_Image *img, GPU_Rect *src_rect, GPU_Rect *clip_rect, GPUBigImage *bigImage, float x, float y) {
+void GPUController::copyGPUImage(GPU_Image *img, GPU_Rect *src_rect, GPU_Rect *clip_rect, GPUBigImage *bigImage, float x, float y, float ratio_x, float ratio_y) {
 
 	if (!bigImage) {
 		ons.errorAndExit("copyGPUImage has null bigImage");
@@ -573,7 +573,10 @@ void GPUController::copyGPUImage(GPU_Image *img, GPU_Rect *src_rect, GPU_Rect *c
 		GPU_Target *target = image.first->target;
 		dst_clip.w         = image.second.w;
 		dst_clip.h         = image.second.h;
-		copyGPUImage(img, src_rect, nullptr, target, x - image.second.x - off_x, y - image.second.y - off_y);
+		if (ratio_x == 1 && ratio_y == 1)
+			copyGPUImage(img, src_rect, nullptr, target, x - image.second.x - off_x, y - image.second.y - off_y);
+		else
+			copyGPUImage(img, src_rect, nullptr, target, x - image.second.x, y - image.second.y, ratio_x, ratio_y, 0, true);
 	}
 }
 
@@ -440,7 +440,7 @@ public:
 	void setShaderVar(const char *name, const SDL_Color &color);
 	void clearWholeTarget(GPU_Target *target, uint8_t r = 0, uint8_t g = 0, uint8_t b = 0, uint8_t a = 0);
 	void copyGPUImage(GPU_Image *img, GPU_Rect *src_rect, GPU_Rect *clip_rect, GPU_Target *target, float x = 0, float y = 0, float ratio_x = 1, float ratio_y = 1, float angle = 0, bool centre_coordinates = false);
-	void copyGPUImage(GPU_Image *img, GPU_Rect *src_rect, GPU_Rect *clip_rect, GPUBigImage *bigImage, float x = 0, float y = 0);
+	void copyGPUImage(GPU_Image *img, GPU_Rect *src_rect, GPU_Rect *clip_rect, GPUBigImage *bigImage, float x = 0, float y = 0, float ratio_x = 1, float ratio_y = 1);
 	void updateImage(GPU_Image *image, const GPU_Rect *image_rect, SDL_Surface *surface, const GPU_Rect *surface_rect, bool finish = true);
 	void convertNV12ToRGB(GPU_Image *image, GPU_Image **imgs, GPU_Rect &rect, uint8_t *planes[4], int *linesizes, bool masked);
 	void convertYUVToRGB(GPU_Image *image, GPU_Image **imgs, GPU_Rect &rect, uint8_t *planes[4], int *linesizes, bool masked);
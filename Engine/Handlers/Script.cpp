@@ -11,16 +11,16 @@
 #include "Engine/Core/ONScripter.hpp"
 #include "Support/Unicode.hpp"
 #include "Support/FileIO.hpp"
+#include "Support/Parallel.hpp"
 #include "External/slre.h"
 
 #include <sys/stat.h>
 #include <sys/types.h>
 
-#ifdef PUBLIC_RELEASE
 #include <zlib.h>
-#endif
 
 #include <algorithm>
+#include <atomic>
 #include <vector>
 #include <unordered_map>
 
@@ -30,6 +30,26 @@ inline void SKIP_SPACE(T *&p) {
 		p++;
 }
 
+// Splits a script buffer ending with a line break into pieces for runParallel.
+// Every piece starts at the beginning of a line, small scripts are not split at all.
+static std::vector<const char *> splitScriptLines(const char *buf, size_t length) {
+	static constexpr size_t MinPieceLength{0x40000};
+	size_t count = parallelThreadCount();
+	count        = std::max<size_t>(std::min(count, length / MinPieceLength), 1);
+
+	const char *end = buf + length;
+	std::vector<const char *> bounds{buf};
+	for (size_t i = 1; i < count; i++) {
+		auto pos = std::max(buf + length * i / count, bounds.back());
+		pos      = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+		if (!pos || pos + 1 >= end)
+			break;
+		bounds.emplace_back(pos + 1);
+	}
+	bounds.emplace_back(end);
+	return bounds;
+}
+
 ScriptHandler::ScriptHandler() {
 	log_info[LABEL_LOG].filename = "NScrllog.dat";
 	log_info[FILE_LOG].filename  = "NScrflog.dat";
@@ -49,9 +69,9 @@ void ScriptHandler::reset() {
 	for (uint32_t i = 0; i < VARIABLE_RANGE; i++)
 		variable_data[i].reset(true);
 
-	freearr(&extended_variable_data);
-	num_extended_variable_data = 0;
-	max_extended_variable_data = 1;
+	for (auto &variable : extended_variable_data)
+		variable.second.reset(true);
+	extended_variable_data.clear();
 
 	ArrayVariable *av = root_array_variable;
 	while (av) {
@@ -65,11 +85,11 @@ void ScriptHandler::reset() {
 	resetLog(log_info[LABEL_LOG]);
 	resetLog(log_info[FILE_LOG]);
 
-	// reset number alias
-	num_alias.clear();
-
-	// reset string alias
-	str_alias.clear();
+	// reset number and string aliases
+	alias_ids.clear();
+	alias_symbols.clear();
+	alias_references.clear();
+	int_expressions.clear();
 
 	// reset misc. variables
 	end_status       = END_NONE;
@@ -560,6 +580,24 @@ const char *ScriptHandler::getAddress(int offset) {
 	return script_buffer + offset;
 }
 
+void ScriptHandler::indexLines() {
+	auto bounds = splitScriptLines(script_buffer, script_buffer_length);
+	std::vector<std::vector<uint32_t>> breaks(bounds.size() - 1);
+
+	runParallel(breaks.size(), [this, &bounds, &breaks](size_t i) {
+		const char *end = bounds[i + 1];
+		for (auto buf = bounds[i]; buf < end; buf++) {
+			buf = static_cast<const char *>(std::memchr(buf, '\n', end - buf));
+			if (!buf)
+				break;
+			breaks[i].emplace_back(static_cast<uint32_t>(buf - script_buffer));
+		}
+	}, "ScriptLoader");
+
+	line_breaks.clear();
+	for (auto &piece : breaks) line_breaks.insert(line_breaks.end(), piece.begin(), piece.end());
+}
+
 int ScriptHandler::getLineByAddress(const char *address, LabelInfo *guaranteeInLabel) {
 	if ((address < script_buffer) || (address >= script_buffer + script_buffer_length)) {
 		errorAndExit("getLineByAddress: outside script bounds", nullptr, "Address Error");
@@ -568,27 +606,26 @@ int ScriptHandler::getLineByAddress(const char *address, LabelInfo *guaranteeInL
 
 	LabelInfo *label = guaranteeInLabel ? guaranteeInLabel : getLabelByAddress(address);
 
-	const char *addr = label->label_header;
-	int line         = 0;
-	while (address > addr && line < label->num_of_lines) {
-		if (*addr == 0x0a)
-			line++;
-		addr++;
-	}
-	return line;
+	// Count the line breaks between the label header and the address
+	auto from = std::lower_bound(line_breaks.begin(), line_breaks.end(), static_cast<uint32_t>(label->label_header - script_buffer));
+	auto to   = std::lower_bound(from, line_breaks.end(), static_cast<uint32_t>(address - script_buffer));
+	return std::min(static_cast<int>(to - from), label->num_of_lines);
 }
 
 const char *ScriptHandler::getAddressByLine(int line) {
 	LabelInfo *label = getLabelByLine(line);
 
-	int l            = line - label->start_line;
-	const char *addr = label->label_header;
-	while (l > 0) {
-		while (*addr != 0x0a) addr++;
-		addr++;
-		l--;
+	int l = line - label->start_line;
+	if (l <= 0)
+		return label->label_header;
+
+	// Skip to the line following the l-th line break after the label header
+	auto first = std::lower_bound(line_breaks.begin(), line_breaks.end(), static_cast<uint32_t>(label->label_header - script_buffer));
+	if (line_breaks.end() - first < l) {
+		errorAndExit("getAddressByLine: outside script bounds", nullptr, "Address Error");
+		return nullptr; //dummy
 	}
-	return addr;
+	return script_buffer + first[l - 1] + 1;
 }
 
 uint32_t ScriptHandler::getLabelIndex(LabelInfo *label) {
@@ -616,60 +653,34 @@ LabelInfo *ScriptHandler::getLabelByAddress(const char *address) {
 		return &label_info[num_of_labels];
 	}
 
-	static LRUCache<const char *, LabelInfo *, std::unordered_map> addressCache(100, false);
-	LabelInfo *label = nullptr;
-	try {
-		label = addressCache.get(address);
-		if (label)
-			return label;
-	} catch (int) {
-		uint32_t i;
-		for (i = 0; i < num_of_labels - 1; i++) {
-			if (label_info[i + 1].start_address > address) {
-				addressCache.set(address, &label_info[i]);
-				return &label_info[i];
-			}
-		}
-		addressCache.set(address, &label_info[i]);
-		return &label_info[i];
-	}
-	return &label_info[num_of_labels];
+	if (num_of_labels == 0)
+		return &label_info[num_of_labels];
+
+	// Labels are stored in script order, find the last one starting at or before the address
+	auto next = std::upper_bound(label_info + 1, label_info + num_of_labels, address,
+	                             [](const char *addr, const LabelInfo &label) { return addr < label.start_address; });
+	return next - 1;
 }
 
 LabelInfo *ScriptHandler::getLabelByLine(int line) {
-	static LRUCache<int, LabelInfo *, std::unordered_map> lineCache(100, false);
-	LabelInfo *label = nullptr;
-	try {
-		label = lineCache.get(line);
-		if (label)
-			return label;
-	} catch (int) {
-		uint32_t i;
-		for (i = 0; i < num_of_labels - 1; i++) {
-			if (label_info[i + 1].start_line > line) {
-				lineCache.set(line, &label_info[i]);
-				return &label_info[i];
-			}
-		}
-		if (i == num_of_labels - 1) {
-			int num_lines = label_info[i].start_line + label_info[i].num_of_lines;
-			if (line >= num_lines) {
-				std::snprintf(errbuf, MAX_ERRBUF_LEN,
-				              "getLabelByLine: line %d outside script bounds (%d lines)",
-				              line, num_lines);
-				errorAndExit(errbuf, nullptr, "Address Error");
-			}
+	if (num_of_labels == 0)
+		return &label_info[num_of_labels];
+
+	auto next = std::upper_bound(label_info + 1, label_info + num_of_labels, line,
+	                             [](int l, const LabelInfo &label) { return l < label.start_line; });
+	auto label = next - 1;
+
+	if (label == &label_info[num_of_labels - 1]) {
+		int num_lines = label->start_line + label->num_of_lines;
+		if (line >= num_lines) {
+			std::snprintf(errbuf, MAX_ERRBUF_LEN,
+			              "getLabelByLine: line %d outside script bounds (%d lines)",
+			              line, num_lines);
+			errorAndExit(errbuf, nullptr, "Address Error");
 		}
-		lineCache.set(line, &label_info[i]);
-		return &label_info[i];
 	}
-	return &label_info[num_of_labels];
-	/*	//sendToLog(LogLevel::Error, "Trying to find line with number %i ...\n", line);
-	LabelInfo *label = labelsMapByLine(line);
-	//sendToLog(LogLevel::Error, "label = %p.\n", label);
-	if (label) return *label;
-	//sendToLog(LogLevel::Error, "Failed.\n");
-	return label_info[num_of_labels];*/
+
+	return label;
 }
 
 bool ScriptHandler::isName(const char *name, bool attack_end) {
@@ -1075,6 +1086,35 @@ static constexpr uint8_t CompressedConversionTable[256]{
     0x46, 0x26, 0xa2, 0x17, 0xc5, 0x75, 0x91, 0x27, 0xb5, 0x8a, 0xd3, 0x13, 0x2e, 0xc4, 0xe9, 0x9d,
     0x97, 0x39, 0x32, 0x05, 0x0f, 0xca, 0xcc, 0x48, 0xfc, 0xae, 0x96, 0xed, 0x6c, 0x9c, 0xb1, 0xa3};
 
+// Both xors of a conversion pass folded into the table, one lookup per byte
+struct CompressedConversion {
+	uint8_t table[256];
+
+	explicit CompressedConversion(const uint32_t (&crc)[2]) {
+		for (uint32_t i = 0; i < 256; i++)
+			table[i] = static_cast<uint8_t>(CompressedConversionTable[i ^ crc[0]] ^ crc[1]);
+	}
+
+	void apply(uint8_t *dst, const uint8_t *src, size_t len) const {
+		size_t i = 0;
+		// Independent lookups let the CPU overlap the loads
+		for (; i + 8 <= len; i += 8) {
+			dst[i]     = table[src[i]];
+			dst[i + 1] = table[src[i + 1]];
+			dst[i + 2] = table[src[i + 2]];
+			dst[i + 3] = table[src[i + 3]];
+			dst[i + 4] = table[src[i + 4]];
+			dst[i + 5] = table[src[i + 5]];
+			dst[i + 6] = table[src[i + 6]];
+			dst[i + 7] = table[src[i + 7]];
+		}
+		for (; i < len; i++) dst[i] = table[src[i]];
+	}
+};
+
+static const CompressedConversion CompressedConversionA{CompressedCrcA};
+static const CompressedConversion CompressedConversionB{CompressedCrcB};
+
 static bool verifyHeader(ScriptHandler::CompressedHeader &header) {
 	return header.magic == CompressedMagic && header.version == CompressedVersion &&
 	       cmp::clamp(header.decompressed, CompressedMin, CompressedMax) == header.decompressed &&
@@ -1161,47 +1201,122 @@ int ScriptHandler::readScript() {
 		return true;
 	};
 
-	bool script_valid = false;
+	bool script_valid  = false;
+	bool script_cached = false;
+	uint32_t raw_crc   = 0;
+	size_t raw_length  = 0;
+	std::string cache_path;
+#ifdef PUBLIC_RELEASE
+	uint8_t *decompressed{nullptr};
+	size_t decompressed_length{0};
+#endif
+
+	// The raw script data identifies the prepared script kept from the previous launch
+	auto lookupCache = [this, &script_data, &script_cached, &raw_crc, &raw_length, &cache_path, filename]() {
+		if (ons.ons_cfg_options.count("no-script-cache"))
+			return;
+		raw_length = script_data.size();
+		raw_crc    = static_cast<uint32_t>(crc32(crc32(0, nullptr, 0), script_data.data(), static_cast<uInt>(raw_length)));
+		cache_path = getScriptCachePath(filename);
+		if (!cache_path.empty())
+			script_cached = loadScriptCache(cache_path, raw_crc, raw_length);
+	};
 
 	FileIO::readFile(fp, tmp_length, &tmp_buffer, true);
 
 #ifndef PUBLIC_RELEASE
 	if (appendScript()) {
+		script_valid = true;
 		if (coding_mode == ScriptEncoding::MultiPlain) {
+			// Parts are opened in order, then read concurrently straight into their place
+			struct ScriptPart {
+				FILE *fp;
+				size_t offset;
+				size_t length;
+			};
+			std::vector<ScriptPart> parts;
+			size_t total_length = script_data.size();
 			for (size_t i = 1; i < 100; i++) {
 				char filename[8];
 				std::snprintf(filename, sizeof(filename), "%zu.txt", i);
-				if (!FileIO::readFile(filename, ons.script_path, tmp_length, &tmp_buffer)) {
+				FILE *part = FileIO::openFile(filename, "rb", ons.script_path);
+				if (!part) {
 					std::snprintf(filename, sizeof(filename), "%02zu.txt", i);
-					if (!FileIO::readFile(filename, ons.script_path, tmp_length, &tmp_buffer))
+					part = FileIO::openFile(filename, "rb", ons.script_path);
+					if (!part)
 						break;
 				}
-				if (!appendScript())
+				size_t part_length{0};
+				FileIO::readFile(part, part_length, nullptr);
+				if (part_length == 0) {
+					std::fclose(part);
 					break;
+				}
+				parts.push_back({part, total_length, part_length});
+				total_length += part_length + 1;
 			}
+
+			// Every part is followed by a line break, the buffer is filled with them beforehand
+			script_data.resize(total_length, '\n');
+			std::atomic<bool> failed{false};
+			runParallel(parts.size(), [&parts, &script_data, &failed](size_t i) {
+				auto &part = parts[i];
+				if (std::fread(script_data.data() + part.offset, part.length, 1, part.fp) != 1)
+					failed.store(true, std::memory_order_relaxed);
+				std::fclose(part.fp);
+			}, "ScriptLoader");
+			script_valid = !failed.load(std::memory_order_relaxed);
 		}
-		script_valid = true;
+		if (script_valid)
+			lookupCache();
 	}
 #else
 	if (appendScript() && tmp_length > sizeof(CompressedHeader)) {
 		auto header = reinterpret_cast<CompressedHeader *>(script_data.data());
 
-		if (verifyHeader(*header)) {
-			uint8_t *compressed = script_data.data() + sizeof(CompressedHeader);
-			for (size_t i = 0; i < header->compressed; i++) {
-				compressed[i] = CompressedConversionTable[compressed[i] ^ CompressedCrcA[0]] ^ CompressedCrcA[1];
-			}
-
-			uLongf decompressed_length = header->decompressed;
-			std::vector<uint8_t> decompressed(decompressed_length);
-			int z = uncompress(decompressed.data(), &decompressed_length, compressed, header->compressed);
-			if (z == Z_OK) {
-				for (uLongf i = 0; i < decompressed_length; i++) {
-					decompressed[i] = CompressedConversionTable[decompressed[i] ^ CompressedCrcB[0]] ^ CompressedCrcB[1];
+		lookupCache();
+		if (script_cached) {
+			script_valid = true;
+		} else if (verifyHeader(*header) && header->compressed <= tmp_length - sizeof(CompressedHeader)) {
+			// Inflate straight into the final script buffer, both conversion passes happen on the way
+			z_stream stream{};
+			if (inflateInit(&stream) == Z_OK) {
+				auto buffer      = new char[header->decompressed + 3];
+				stream.next_out  = reinterpret_cast<Bytef *>(buffer);
+				stream.avail_out = header->decompressed;
+
+				uint8_t chunk[0x4000];
+				const uint8_t *compressed = script_data.data() + sizeof(CompressedHeader);
+				size_t compressed_left    = header->compressed;
+				int z                     = Z_OK;
+				while (z == Z_OK) {
+					if (stream.avail_in == 0) {
+						if (compressed_left == 0)
+							break;
+						size_t len = std::min(compressed_left, sizeof(chunk));
+						CompressedConversionA.apply(chunk, compressed, len);
+						compressed += len;
+						compressed_left -= len;
+						stream.next_in  = chunk;
+						stream.avail_in = static_cast<uInt>(len);
+					}
+					auto out = stream.next_out;
+					z        = inflate(&stream, Z_NO_FLUSH);
+					CompressedConversionB.apply(out, out, stream.next_out - out);
+				}
+				inflateEnd(&stream);
+
+				if (z == Z_STREAM_END) {
+					// Terminate like the plain scripts, preprocessScript may peek one byte past the end
+					buffer[stream.total_out]     = '\n';
+					buffer[stream.total_out + 1] = '\0';
+					buffer[stream.total_out + 2] = '\0';
+					decompressed_length          = stream.total_out + 2;
+					decompressed                 = reinterpret_cast<uint8_t *>(buffer);
+					script_valid                 = true;
+				} else {
+					delete[] buffer;
 				}
-				decompressed.emplace_back('\n');
-				script_data = decompressed;
-				script_valid = true;
 			}
 		}
 	}
@@ -1212,11 +1327,24 @@ int ScriptHandler::readScript() {
 		return -1; // dummy
 	}
 
-	script_data.emplace_back('\0');
-	freearr(&script_buffer); // Why did we decide to free the buffer here?
-	script_buffer_length = preprocessScript(script_data.data(), script_data.size());
-	script_buffer        = copyarr(reinterpret_cast<char *>(script_data.data()), script_buffer_length + 1);
-	game_hash            = static_cast<uint32_t>(script_buffer_length); // Reasonable "hash" value
+	if (!script_cached) {
+		freearr(&script_buffer); // Why did we decide to free the buffer here?
+#ifdef PUBLIC_RELEASE
+		// The inflated script is prepared in place and becomes the script buffer as is
+		script_data.clear();
+		script_data.shrink_to_fit();
+		script_buffer_length = preprocessScript(decompressed, decompressed_length);
+		script_buffer        = reinterpret_cast<char *>(decompressed);
+#else
+		script_data.emplace_back('\0');
+		script_buffer_length = preprocessScript(script_data.data(), script_data.size());
+		script_buffer        = copyarr(reinterpret_cast<char *>(script_data.data()), script_buffer_length + 1);
+#endif
+	}
+	game_hash = static_cast<uint32_t>(script_buffer_length); // Reasonable "hash" value
+	indexLines();
+	int_expressions.clear();
+	alias_references.clear();
 
 	//sendToLog(LogLevel::Info,"num_of_labels %d\n",num_of_labels);
 
@@ -1298,6 +1426,10 @@ int ScriptHandler::readScript() {
 			buf++;
 	}
 
+	// Labels come with the cached script, they were checked before it was stored
+	if (script_cached)
+		return 0;
+
 	auto r = labelScript();
 	if (r)
 		return r;
@@ -1315,47 +1447,284 @@ int ScriptHandler::readScript() {
 		labels.emplace(label_info[i].name, i);
 	}
 
+	if (!cache_path.empty())
+		saveScriptCache(cache_path, raw_crc, raw_length);
+
 	return 0;
 }
 
-int ScriptHandler::labelScript() {
-	int label_counter = -1;
-	int current_line  = 0;
-	const char *buf   = script_buffer;
-	label_info        = new LabelInfo[num_of_labels + 1];
-	logState.readLabels.resize(num_of_labels + 1); // unsure if +1 is required
+// Script cache layout, native byte order as it never leaves the machine:
+// - header (see below);
+// - preprocessed script buffer with the terminating zero (obfuscated like the compressed script in public releases);
+// - label records followed by their names without terminators.
+// The cache is only trusted when the raw script data it was made from has the same length and CRC-32.
+static constexpr uint32_t ScriptCacheMagic{0x43534E4F}; // ONSC
+static constexpr uint32_t ScriptCacheVersion{1};
+
+struct ScriptCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t raw_crc;
+	uint32_t num_of_labels;
+	uint64_t raw_length;
+	uint64_t buffer_length;
+};
+
+struct ScriptCacheLabel {
+	uint64_t header_offset;
+	uint64_t start_offset;
+	int32_t start_line;
+	int32_t num_of_lines;
+	uint32_t name_length;
+	uint32_t reserved;
+};
 
-	while (buf < script_buffer + script_buffer_length) {
+#ifdef PUBLIC_RELEASE
+static void obfuscateScriptCache(uint8_t *buf, size_t len, bool encode) {
+	if (!encode) {
+		CompressedConversionB.apply(buf, buf, len);
+		return;
+	}
+
+	static uint8_t inverse[256];
+	if (inverse[CompressedConversionTable[1]] != 1) {
+		for (size_t i = 0; i < 256; i++)
+			inverse[CompressedConversionTable[i]] = static_cast<uint8_t>(i);
+	}
+	for (size_t i = 0; i < len; i++)
+		buf[i] = inverse[buf[i] ^ CompressedCrcB[1]] ^ CompressedCrcB[0];
+}
+#endif
+
+std::string ScriptHandler::getScriptCachePath(const char *filename) {
+	// One cache file per script location, so that an edited script replaces its own cache
+	std::string location(ons.script_path);
+	location += filename;
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%08X.dat", static_cast<uint32_t>(HashedString(location.c_str()).hash));
+
+	std::string path(FileIO::getStorageDir());
+	path += "ScriptCache";
+	if (!FileIO::makeDir(path))
+		return {};
+	path += DELIMITER;
+	path += name;
+	return path;
+}
+
+bool ScriptHandler::loadScriptCache(const std::string &path, uint32_t raw_crc, size_t raw_length) {
+	FILE *fp = FileIO::openFile(path, "rb");
+	if (!fp)
+		return false;
+
+	size_t file_length{0};
+	FileIO::readFile(fp, file_length, nullptr);
+
+	ScriptCacheHeader header;
+	if (std::fread(&header, sizeof(header), 1, fp) != 1 || header.magic != ScriptCacheMagic ||
+	    header.version != ScriptCacheVersion || header.raw_crc != raw_crc || header.raw_length != raw_length ||
+	    header.buffer_length == 0 || header.buffer_length >= file_length ||
+	    header.num_of_labels > (file_length - header.buffer_length) / sizeof(ScriptCacheLabel)) {
+		std::fclose(fp);
+		return false;
+	}
+
+	size_t buffer_length = static_cast<size_t>(header.buffer_length);
+	auto buffer          = new char[buffer_length + 1];
+	std::vector<ScriptCacheLabel> labels(header.num_of_labels);
+	std::vector<char> names;
+
+	bool valid = std::fread(buffer, buffer_length + 1, 1, fp) == 1 &&
+	             (labels.empty() || std::fread(labels.data(), sizeof(ScriptCacheLabel) * labels.size(), 1, fp) == 1);
+
+	size_t names_length = 0;
+	for (size_t i = 0; valid && i < labels.size(); i++) {
+		valid = labels[i].header_offset <= labels[i].start_offset && labels[i].start_offset <= buffer_length &&
+		        labels[i].name_length < buffer_length;
+		names_length += labels[i].name_length;
+	}
+	valid = valid && names_length <= file_length;
+	if (valid) {
+		names.resize(names_length + 1);
+		valid = names_length == 0 || std::fread(names.data(), names_length, 1, fp) == 1;
+	}
+
+	std::fclose(fp);
+
+#ifdef PUBLIC_RELEASE
+	if (valid)
+		obfuscateScriptCache(reinterpret_cast<uint8_t *>(buffer), buffer_length + 1, false);
+#endif
+
+	if (!valid || buffer[buffer_length] != '\0') {
+		delete[] buffer;
+		sendToLog(LogLevel::Warn, "Ignoring damaged script cache %s\n", path.c_str());
+		return false;
+	}
+
+	freearr(&script_buffer);
+	script_buffer        = buffer;
+	script_buffer_length = buffer_length;
+	num_of_labels        = header.num_of_labels;
+
+	label_info = new LabelInfo[num_of_labels + 1];
+	logState.readLabels.resize(num_of_labels + 1);
+
+	const char *name = names.data();
+	for (uint32_t i = 0; i < num_of_labels; i++) {
+		auto &label         = label_info[i];
+		label.name          = new char[labels[i].name_length + 1];
+		label.label_header  = script_buffer + labels[i].header_offset;
+		label.start_address = script_buffer + labels[i].start_offset;
+		label.start_line    = labels[i].start_line;
+		label.num_of_lines  = labels[i].num_of_lines;
+		copystr(label.name, name, labels[i].name_length + 1);
+		name += labels[i].name_length;
+
+		std::string lowered(label.name);
+		std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+		labelsByName[lowered] = i;
+	}
+	label_info[num_of_labels].start_address = nullptr;
+
+	return true;
+}
+
+void ScriptHandler::saveScriptCache(const std::string &path, uint32_t raw_crc, size_t raw_length) {
+	ScriptCacheHeader header{ScriptCacheMagic, ScriptCacheVersion, raw_crc, num_of_labels, raw_length, script_buffer_length};
+
+	std::vector<ScriptCacheLabel> labels(num_of_labels);
+	std::string names;
+	for (uint32_t i = 0; i < num_of_labels; i++) {
+		auto &label        = labels[i];
+		size_t name_length = std::strlen(label_info[i].name);
+		label.header_offset = static_cast<uint64_t>(label_info[i].label_header - script_buffer);
+		label.start_offset  = static_cast<uint64_t>(label_info[i].start_address - script_buffer);
+		label.start_line    = label_info[i].start_line;
+		label.num_of_lines  = label_info[i].num_of_lines;
+		label.name_length   = static_cast<uint32_t>(name_length);
+		label.reserved      = 0;
+		names.append(label_info[i].name, name_length);
+	}
+
+	std::vector<uint8_t> buffer(reinterpret_cast<uint8_t *>(script_buffer),
+	                            reinterpret_cast<uint8_t *>(script_buffer) + script_buffer_length + 1);
+#ifdef PUBLIC_RELEASE
+	obfuscateScriptCache(buffer.data(), buffer.size(), true);
+#endif
+
+	// Write aside and replace, a cache cut short by a crash must not be picked up
+	std::string tmp_path = path + ".tmp";
+	FILE *fp             = FileIO::openFile(tmp_path, "wb");
+	if (!fp)
+		return;
+
+	bool written = std::fwrite(&header, sizeof(header), 1, fp) == 1 &&
+	               std::fwrite(buffer.data(), buffer.size(), 1, fp) == 1 &&
+	               (labels.empty() || std::fwrite(labels.data(), sizeof(ScriptCacheLabel) * labels.size(), 1, fp) == 1) &&
+	               (names.empty() || std::fwrite(names.data(), names.size(), 1, fp) == 1);
+	written &= std::fclose(fp) == 0;
+
+	if (!written || !FileIO::renameFile(tmp_path, path, true)) {
+		sendToLog(LogLevel::Warn, "Failed to store script cache %s\n", path.c_str());
+		FileIO::removeFile(tmp_path);
+	}
+}
+
+struct ScannedLabels {
+	struct Label {
+		std::string name;
+		const char *label_header;
+		const char *start_address;
+		int start_line;
+		int num_of_lines;
+	};
+	std::vector<Label> labels;
+	int leading_lines{0}; // lines before the first label, they belong to the previous piece's last one
+	int lines{0};
+};
+
+// Finds the labels in a piece of the script starting at the beginning of a line.
+// Does the same as readLabel for *NAME but touches no parser state, so pieces can be scanned concurrently.
+static void scanLabels(const char *buf, const char *end, ScannedLabels &scan) {
+	while (buf < end) {
 		SKIP_SPACE(buf);
 		if (*buf == '*') {
-			setCurrent(buf);
-			readLabel();
-			size_t len                       = string_buffer.length();
-			label_info[++label_counter].name = new char[len];
-			copystr(label_info[label_counter].name, string_buffer.c_str() + 1, len);
-			label_info[label_counter].label_header = buf;
-			label_info[label_counter].num_of_lines = 1;
-			label_info[label_counter].start_line   = current_line;
-
-			buf = getNext();
-			if (*buf == '\n') {
+			ScannedLabels::Label label;
+			label.label_header = buf;
+			label.num_of_lines = 1;
+			label.start_line   = scan.lines;
+
+			while (*buf == '*') buf++;
+			SKIP_SPACE(buf);
+			while ((*buf >= 'a' && *buf <= 'z') ||
+			       (*buf >= 'A' && *buf <= 'Z') ||
+			       (*buf >= '0' && *buf <= '9') ||
+			       *buf == '_') {
+				label.name += static_cast<char>(*buf >= 'A' && *buf <= 'Z' ? *buf + 'a' - 'A' : *buf);
+				buf++;
+			}
+			SKIP_SPACE(buf);
+			if (*buf == ',') {
 				buf++;
 				SKIP_SPACE(buf);
-				current_line++;
 			}
-			label_info[label_counter].start_address = buf;
 
-			std::string name(label_info[label_counter].name);
-			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-			labelsByName[name] = label_counter;
+			if (*buf == '\n') {
+				buf++;
+				SKIP_SPACE(buf);
+				scan.lines++;
+			}
+			label.start_address = buf;
+			scan.labels.emplace_back(std::move(label));
 		} else {
-			if (label_counter >= 0)
-				label_info[label_counter].num_of_lines++;
+			if (scan.labels.empty())
+				scan.leading_lines++;
+			else
+				scan.labels.back().num_of_lines++;
 			while (*buf != '\n') buf++;
 			buf++;
-			current_line++;
+			scan.lines++;
 		}
 	}
+}
+
+int ScriptHandler::labelScript() {
+	auto bounds = splitScriptLines(script_buffer, script_buffer_length);
+	std::vector<ScannedLabels> scans(bounds.size() - 1);
+	runParallel(scans.size(), [&bounds, &scans](size_t i) {
+		scanLabels(bounds[i], bounds[i + 1], scans[i]);
+	}, "ScriptLoader");
+
+	// Trust the labels actually found over the preliminary count from preprocessScript
+	size_t found = 0;
+	for (auto &scan : scans) found += scan.labels.size();
+	num_of_labels = static_cast<uint32_t>(found);
+
+	label_info = new LabelInfo[num_of_labels + 1];
+	logState.readLabels.resize(num_of_labels + 1); // unsure if +1 is required
+
+	int label_counter = -1;
+	int current_line  = 0;
+	for (auto &scan : scans) {
+		if (label_counter >= 0)
+			label_info[label_counter].num_of_lines += scan.leading_lines;
+
+		for (auto &scanned : scan.labels) {
+			auto &label         = label_info[++label_counter];
+			size_t len          = scanned.name.length() + 1;
+			label.name          = new char[len];
+			copystr(label.name, scanned.name.c_str(), len);
+			label.label_header  = scanned.label_header;
+			label.start_address = scanned.start_address;
+			label.start_line    = current_line + scanned.start_line;
+			label.num_of_lines  = scanned.num_of_lines;
+
+			labelsByName[scanned.name] = label_counter;
+		}
+		current_line += scan.lines;
+	}
 
 	label_info[num_of_labels].start_address = nullptr;
 
@@ -1444,23 +1813,48 @@ ArrayVariable *ScriptHandler::getRootArrayVariable() {
 }
 
 bool ScriptHandler::findNumAlias(const char *str, int *value) {
-	auto it = num_alias.find(str);
-	if (it != num_alias.end()) {
-		*value = it->second;
+	auto it = alias_ids.find(str);
+	if (it != alias_ids.end() && alias_symbols[it->second].has_num) {
+		*value = alias_symbols[it->second].num;
 		return true;
 	}
 	return false;
 }
 
 bool ScriptHandler::findStrAlias(const char *str, std::string *buffer) {
-	auto it = str_alias.find(str);
-	if (it != str_alias.end()) {
-		*buffer = it->second.str;
+	auto it = alias_ids.find(str);
+	if (it != alias_ids.end() && alias_symbols[it->second].has_str) {
+		*buffer = alias_symbols[it->second].str;
 		return true;
 	}
 	return false;
 }
 
+uint32_t ScriptHandler::internAlias(const char *name) {
+	auto it = alias_ids.find(name);
+	if (it != alias_ids.end())
+		return it->second;
+
+	auto id = static_cast<uint32_t>(alias_symbols.size());
+	alias_symbols.emplace_back();
+	alias_ids.emplace(HashedString(name, true), id);
+	return id;
+}
+
+const ScriptHandler::AliasReference *ScriptHandler::findAliasReference(const char *pos) {
+	if (pos < script_buffer || pos >= script_buffer + script_buffer_length)
+		return nullptr;
+	auto it = alias_references.find(pos);
+	return it != alias_references.end() ? &it->second : nullptr;
+}
+
+void ScriptHandler::addAliasReference(const char *pos, const char *name, size_t length) {
+	// Only the script text stays in place, names in temporary buffers are looked up every time
+	if (pos < script_buffer || pos >= script_buffer + script_buffer_length)
+		return;
+	alias_references.emplace(pos, AliasReference{internAlias(name), static_cast<uint32_t>(length)});
+}
+
 void ScriptHandler::processError(const char *str, const char *title, const char *detail, bool is_warning, bool is_simple, bool force_message) {
 	//if not yet running the script, no line no/cmd - keep it simple
 	if (script_buffer == nullptr)
@@ -1616,24 +2010,7 @@ VariableData &ScriptHandler::getVariableData(uint32_t no) {
 	if (no < VARIABLE_RANGE)
 		return variable_data[no];
 
-	for (uint32_t i = 0; i < num_extended_variable_data; i++)
-		if (extended_variable_data[i].no == no)
-			return extended_variable_data[i].vd;
-
-	num_extended_variable_data++;
-	if (num_extended_variable_data == max_extended_variable_data) {
-		ExtendedVariableData *tmp = extended_variable_data;
-		extended_variable_data    = new ExtendedVariableData[max_extended_variable_data * 2];
-		if (tmp) {
-			std::memcpy(extended_variable_data, tmp, sizeof(ExtendedVariableData) * max_extended_variable_data);
-			delete[] tmp;
-		}
-		max_extended_variable_data *= 2;
-	}
-
-	extended_variable_data[num_extended_variable_data - 1].no = no;
-
-	return extended_variable_data[num_extended_variable_data - 1].vd;
+	return extended_variable_data[no];
 }
 
 // ----------------------------------------
@@ -1742,6 +2119,16 @@ void ScriptHandler::parseStr(const char **buf) {
 		}
 		current_variable.type |= VariableInfo::TypeConst;
 	} else { // str alias
+		if (auto ref = findAliasReference(*buf)) {
+			auto &symbol = alias_symbols[ref->symbol];
+			if (symbol.has_str) {
+				str_string_buffer = symbol.str;
+				*buf += ref->length;
+				current_variable.type |= VariableInfo::TypeConst;
+				return;
+			}
+		}
+
 		char ch, alias_buf[512];
 		int alias_buf_len = 0;
 		bool first_flag   = true;
@@ -1779,6 +2166,7 @@ void ScriptHandler::parseStr(const char **buf) {
 			std::snprintf(errbuf, MAX_ERRBUF_LEN, "Undefined string alias '%s'", alias_buf);
 			errorAndExit(errbuf);
 		}
+		addAliasReference(*buf - alias_buf_len, alias_buf, alias_buf_len);
 		current_variable.type |= VariableInfo::TypeConst;
 	}
 }
@@ -1810,6 +2198,19 @@ int32_t ScriptHandler::parseInt(const char **buf, bool flipSign) {
 	bool num_alias_flag  = false;
 
 	const char *buf_start = *buf;
+	// Aliases met here before are resolved through their symbol
+	if (auto ref = findAliasReference(buf_start)) {
+		auto &symbol = alias_symbols[ref->symbol];
+		if (!symbol.has_num) {
+			current_variable.type = VariableInfo::TypeNone;
+			return 0;
+		}
+		*buf += ref->length;
+		current_variable.type = VariableInfo::TypeInt | VariableInfo::TypeConst;
+		SKIP_SPACE(*buf);
+		return symbol.num;
+	}
+
 	while (true) {
 		ch = **buf;
 
@@ -1847,6 +2248,7 @@ int32_t ScriptHandler::parseInt(const char **buf, bool flipSign) {
 	/* Solve num aliases */
 	if (num_alias_flag) {
 		alias_buf[alias_buf_len] = '\0';
+		addAliasReference(buf_start, alias_buf, alias_buf_len);
 
 		if (!findNumAlias(alias_buf, &alias_no)) {
 			//sendToLog(LogLevel::Info, "can't find num alias for %s... assume 0.\n", alias_buf);
@@ -1870,6 +2272,24 @@ int32_t ScriptHandler::parseIntExpression(const char **buf, bool flipSign) {
 
 	SKIP_SPACE(*buf);
 
+	// Expressions in the script itself are compiled once and run from the cache afterwards
+	if (!flipSign && *buf >= script_buffer && *buf < script_buffer + script_buffer_length) {
+		auto it = int_expressions.find(*buf);
+		if (it == int_expressions.end()) {
+			IntExpression expr;
+			const char *end = *buf;
+			if (compileIntExpression(&end, false, expr) && expr.max_depth <= MaxIntExpressionDepth)
+				expr.length = static_cast<uint32_t>(end - *buf);
+			else
+				expr.program.clear(); // Not compilable, keep interpreting it
+			it = int_expressions.emplace(*buf, std::move(expr)).first;
+		}
+		if (!it->second.program.empty()) {
+			*buf += it->second.length;
+			return runIntExpression(it->second);
+		}
+	}
+
 	readNextOp(buf, nullptr, &num[0]); // overflow here.
 
 	readNextOp(buf, &op[0], &num[1]);
@@ -1982,6 +2402,269 @@ int32_t ScriptHandler::calcArithmetic(int32_t num1, Operator op, int32_t num2) {
 	return ret;
 }
 
+void ScriptHandler::IntExpression::emit(IntInstruction::Code code, int32_t pops, bool flip, int32_t value) {
+	program.push_back({code, flip, value});
+	depth     = depth - pops + (code != IntInstruction::Clear);
+	max_depth = std::max(max_depth, depth);
+}
+
+// The compile functions mirror parseIntExpression, readNextOp, parseInt and parseArray step by step.
+// They return false for anything the interpreter would report as an error.
+bool ScriptHandler::compileIntExpression(const char **buf, bool flipSign, IntExpression &expr) {
+	Operator op[2];
+
+	SKIP_SPACE(*buf);
+
+	if (!compileNextOp(buf, nullptr, expr) || !compileNextOp(buf, &op[0], expr))
+		return false;
+	if (op[0] == Operator::Invalid)
+		return true;
+
+	while (true) {
+		if (!compileNextOp(buf, &op[1], expr))
+			return false;
+		if (op[1] == Operator::Invalid)
+			break;
+
+		if (!(op[0] & Operator::HighPri) && (op[1] & Operator::HighPri)) {
+			expr.emit(IntInstruction::Calc, 2, false, op[1]);
+		} else {
+			expr.emit(IntInstruction::CalcUnder, 3, false, op[0]);
+			expr.depth++; // The top value stays
+			op[0] = op[1];
+		}
+	}
+
+	expr.emit(IntInstruction::Calc, 2, false, op[0]);
+	if (flipSign)
+		expr.emit(IntInstruction::Negate, 1);
+	return true;
+}
+
+bool ScriptHandler::compileNextOp(const char **buf, Operator *op, IntExpression &expr) {
+	bool minus_flag = false;
+	SKIP_SPACE(*buf);
+	const char *buf_start = *buf;
+
+	if (op) {
+		if ((*buf)[0] == '+')
+			*op = Operator::Plus;
+		else if ((*buf)[0] == '-')
+			*op = Operator::Minus;
+		else if ((*buf)[0] == '*')
+			*op = Operator::Mult;
+		else if ((*buf)[0] == '/')
+			*op = Operator::Div;
+		else if ((*buf)[0] == 'm' &&
+		         (*buf)[1] == 'o' &&
+		         (*buf)[2] == 'd' &&
+		         ((*buf)[3] == ' ' ||
+		          (*buf)[3] == '\t' ||
+		          (*buf)[3] == '$' ||
+		          (*buf)[3] == '%' ||
+		          (*buf)[3] == '?' ||
+		          ((*buf)[3] >= '0' && (*buf)[3] <= '9')))
+			*op = Operator::Mod;
+		else {
+			*op = Operator::Invalid;
+			return true;
+		}
+		if (*op == Operator::Mod)
+			*buf += 3;
+		else
+			(*buf)++;
+		SKIP_SPACE(*buf);
+	} else {
+		if ((*buf)[0] == '-') {
+			minus_flag = true;
+			(*buf)++;
+			SKIP_SPACE(*buf);
+		}
+	}
+
+	if ((*buf)[0] == '(') {
+		(*buf)++;
+		if (!compileIntExpression(buf, minus_flag, expr))
+			return false;
+		SKIP_SPACE(*buf);
+		if ((*buf)[0] != ')')
+			return false;
+		(*buf)++;
+	} else {
+		bool unknown{false};
+		// An unknown name after an operator only resets the variable type and is not a value
+		if (!compileInt(buf, minus_flag, expr, unknown))
+			return false;
+		if (unknown) {
+			if (op) {
+				expr.program.back().code = IntInstruction::Clear;
+				expr.depth--;
+				*op = Operator::Invalid;
+			}
+			*buf = buf_start;
+		}
+	}
+
+	return true;
+}
+
+bool ScriptHandler::compileInt(const char **buf, bool flipSign, IntExpression &expr, bool &unknown) {
+	SKIP_SPACE(*buf);
+
+	if (**buf == '%') {
+		(*buf)++;
+		bool inner_unknown{false};
+		if (!compileInt(buf, false, expr, inner_unknown))
+			return false;
+		expr.emit(IntInstruction::Variable, 1, flipSign);
+		return true;
+	}
+	if (**buf == '?') {
+		if (!compileArray(buf, expr))
+			return false;
+		expr.program.back().flip = flipSign;
+		return true;
+	}
+
+	char ch, alias_buf[256];
+	int alias_buf_len = 0, alias_no = 0;
+	bool direct_num_flag = false;
+	bool num_alias_flag  = false;
+
+	const char *buf_start = *buf;
+	while (true) {
+		ch = **buf;
+
+		if ((ch >= 'a' && ch <= 'z') ||
+		    (ch >= 'A' && ch <= 'Z') ||
+		    ch == '_') {
+			if (ch >= 'A' && ch <= 'Z')
+				ch += 'a' - 'A';
+			if (direct_num_flag)
+				break;
+			num_alias_flag             = true;
+			alias_buf[alias_buf_len++] = ch;
+		} else if (ch >= '0' && ch <= '9') {
+			if (!num_alias_flag)
+				direct_num_flag = true;
+			if (direct_num_flag) {
+				if (flipSign)
+					alias_no = alias_no * 10 - (ch - '0');
+				else
+					alias_no = alias_no * 10 + (ch - '0');
+			} else {
+				alias_buf[alias_buf_len++] = ch;
+			}
+		} else
+			break;
+		if (alias_buf_len == sizeof(alias_buf) - 1)
+			return false;
+		(*buf)++;
+	}
+
+	if (*buf - buf_start == 0) {
+		unknown = true;
+		expr.emit(IntInstruction::Unknown, 0);
+		return true;
+	}
+
+	if (num_alias_flag) {
+		alias_buf[alias_buf_len] = '\0';
+
+		if (!findNumAlias(alias_buf, &alias_no)) {
+			unknown = true;
+			expr.emit(IntInstruction::Unknown, 0);
+			*buf = buf_start;
+			return true;
+		}
+	}
+
+	expr.emit(IntInstruction::Const, 0, false, alias_no);
+
+	SKIP_SPACE(*buf);
+
+	return true;
+}
+
+bool ScriptHandler::compileArray(const char **buf, IntExpression &expr) {
+	SKIP_SPACE(*buf);
+
+	(*buf)++; // skip '?'
+	bool unknown{false};
+	if (!compileInt(buf, false, expr, unknown))
+		return false;
+
+	SKIP_SPACE(*buf);
+	int32_t num_dim = 0;
+	while (**buf == '[') {
+		(*buf)++;
+		if (num_dim == 20 || !compileIntExpression(buf, false, expr))
+			return false;
+		num_dim++;
+		SKIP_SPACE(*buf);
+		if (**buf != ']')
+			return false;
+		(*buf)++;
+	}
+
+	expr.emit(IntInstruction::Array, num_dim + 1, false, num_dim);
+	return true;
+}
+
+int32_t ScriptHandler::runIntExpression(const IntExpression &expr) {
+	int32_t stack[MaxIntExpressionDepth];
+	size_t top = 0;
+
+	for (auto &instr : expr.program) {
+		switch (instr.code) {
+			case IntInstruction::Const:
+				current_variable.type = VariableInfo::TypeInt | VariableInfo::TypeConst;
+				stack[top++]          = instr.value;
+				break;
+			case IntInstruction::Unknown:
+				current_variable.type = VariableInfo::TypeNone;
+				stack[top++]          = 0;
+				break;
+			case IntInstruction::Clear:
+				current_variable.type = VariableInfo::TypeNone;
+				break;
+			case IntInstruction::Variable: {
+				current_variable.var_no = stack[top - 1];
+				current_variable.type   = VariableInfo::TypeInt;
+				auto v                  = getVariableData(current_variable.var_no).num;
+				stack[top - 1]          = instr.flip ? -v : v;
+				break;
+			}
+			case IntInstruction::Array: {
+				ArrayVariable av;
+				top -= instr.value;
+				av.num_dim = instr.value;
+				for (int32_t i = 0; i < instr.value; i++) av.dim[i] = stack[top + i];
+				current_variable.var_no = stack[top - 1];
+				current_variable.type   = VariableInfo::TypeArray;
+				current_variable.array  = av;
+				auto v                  = *getArrayPtr(current_variable.var_no, current_variable.array, 0);
+				stack[top - 1]          = instr.flip ? -v : v;
+				break;
+			}
+			case IntInstruction::Calc:
+				top--;
+				stack[top - 1] = calcArithmetic(stack[top - 1], static_cast<Operator>(instr.value), stack[top]);
+				break;
+			case IntInstruction::CalcUnder:
+				stack[top - 3] = calcArithmetic(stack[top - 3], static_cast<Operator>(instr.value), stack[top - 2]);
+				stack[top - 2] = stack[top - 1];
+				top--;
+				break;
+			case IntInstruction::Negate:
+				stack[top - 1] = -stack[top - 1];
+				break;
+		}
+	}
+
+	return stack[0];
+}
+
 int32_t ScriptHandler::parseArray(const char **buf, ArrayVariable &array) {
 	SKIP_SPACE(*buf);
 
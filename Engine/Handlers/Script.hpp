@@ -12,7 +12,11 @@
 #include "External/Compatibility.hpp"
 #include "Engine/Entities/Variable.hpp"
 
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 #include <set>
@@ -115,9 +119,13 @@ struct HashedString {
 
 	// Warning: it does not copy passed string bytes by default
 	HashedString(const char *k, bool copy = false) {
-		hash       = static_cast<uint8_t>(k[0]) << 8;
-		size_t len = std::strlen(k);
-		hash |= static_cast<uint32_t>(len << 24) | (len > 0 ? k[len - 1] : 0);
+		// FNV-1a, the length comes for free
+		hash       = 2166136261U;
+		size_t len = 0;
+		for (; k[len]; len++) {
+			hash ^= static_cast<uint8_t>(k[len]);
+			hash *= 16777619U;
+		}
 		copied = copy;
 		if (copy) {
 			str = new char[len + 1];
@@ -172,6 +180,122 @@ struct equal_to<HashedString> {
 };
 } // namespace std
 
+// Immutable name lookup table with a collision-free layout built once from a fixed key set.
+// Keys are spread over small buckets by their hash, each bucket gets a displacement that
+// places all of its keys into free slots, so a lookup costs one probe and one comparison.
+// Mimics the unordered_map interface used by the command tables.
+template <typename T>
+class PerfectHashMap {
+public:
+	using value_type = std::pair<const char *, T>;
+
+	PerfectHashMap(std::initializer_list<value_type> list) {
+		std::vector<value_type> keys;
+		keys.reserve(list.size());
+		for (auto &item : list) {
+			// Like unordered_map, the first definition wins
+			if (std::none_of(keys.begin(), keys.end(), [&item](const value_type &key) { return equalstr(key.first, item.first); }))
+				keys.emplace_back(item);
+		}
+
+		for (size_t size = 8; !build(keys, size); size *= 2) {
+			if (size > keys.size() * 64)
+				throw std::logic_error("Failed to build a perfect hash table");
+		}
+	}
+
+	PerfectHashMap(const PerfectHashMap &) = delete;
+	PerfectHashMap &operator=(const PerfectHashMap &) = delete;
+
+	const value_type *find(const HashedString &key) const {
+		auto index = slotIndex(key.hash, displacements[key.hash & bucketMask]);
+		if (hashes[index] != key.hash || !slots[index].first || !equalstr(slots[index].first, key.str))
+			return end();
+		return &slots[index];
+	}
+	size_t count(const HashedString &key) const {
+		return find(key) != end();
+	}
+	const value_type *end() const {
+		return nullptr;
+	}
+
+private:
+	std::vector<value_type> slots;
+	std::vector<uint32_t> hashes;
+	std::vector<uint32_t> displacements;
+	uint32_t bucketMask{0};
+	uint32_t slotMask{0};
+
+	FORCE_INLINE uint32_t slotIndex(uint32_t hash, uint32_t displacement) const {
+		// murmur3 finaliser, decorrelates the slot from the bucket bits
+		hash ^= displacement;
+		hash ^= hash >> 16;
+		hash *= 0x85EBCA6BU;
+		hash ^= hash >> 13;
+		hash *= 0xC2B2AE35U;
+		hash ^= hash >> 16;
+		return hash & slotMask;
+	}
+
+	bool build(const std::vector<value_type> &keys, size_t size) {
+		// Slots are kept at most half full with four keys per bucket on average
+		if (size < keys.size() * 2)
+			return false;
+
+		slotMask   = static_cast<uint32_t>(size - 1);
+		bucketMask = static_cast<uint32_t>(std::max<size_t>(size / 8, 1) - 1);
+		slots.assign(size, value_type{nullptr, T{}});
+		hashes.assign(size, 0);
+		displacements.assign(bucketMask + 1, 0);
+
+		std::vector<std::vector<size_t>> buckets(bucketMask + 1);
+		std::vector<uint32_t> keyHashes(keys.size());
+		for (size_t i = 0; i < keys.size(); i++) {
+			keyHashes[i] = HashedString(keys[i].first).hash;
+			buckets[keyHashes[i] & bucketMask].emplace_back(i);
+		}
+
+		// Place the most crowded buckets first while there is more room
+		std::vector<size_t> order(buckets.size());
+		for (size_t i = 0; i < order.size(); i++) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) {
+			return buckets[a].size() > buckets[b].size();
+		});
+
+		std::vector<uint32_t> taken;
+		for (auto b : order) {
+			auto &bucket = buckets[b];
+			if (bucket.empty())
+				break;
+
+			bool placed{false};
+			for (uint32_t displacement = 1; displacement < 0x10000 && !placed; displacement++) {
+				taken.clear();
+				for (auto i : bucket) {
+					auto index = slotIndex(keyHashes[i], displacement);
+					if (slots[index].first || std::find(taken.begin(), taken.end(), index) != taken.end())
+						break;
+					taken.emplace_back(index);
+				}
+				if (taken.size() == bucket.size()) {
+					for (size_t j = 0; j < bucket.size(); j++) {
+						slots[taken[j]]  = keys[bucket[j]];
+						hashes[taken[j]] = keyHashes[bucket[j]];
+					}
+					displacements[b] = displacement;
+					placed           = true;
+				}
+			}
+
+			if (!placed)
+				return false;
+		}
+
+		return true;
+	}
+};
+
 class ScriptHandler {
 public:
 	enum { END_NONE       = 0,
@@ -334,6 +458,9 @@ public:
 	bool isScript(const std::string &filename);
 	int readScript();
 	int labelScript();
+	std::string getScriptCachePath(const char *filename);
+	bool loadScriptCache(const std::string &path, uint32_t raw_crc, size_t raw_length);
+	void saveScriptCache(const std::string &path, uint32_t raw_crc, size_t raw_length);
 
 	LabelInfo *lookupLabel(const char *label);
 	LabelInfo *lookupLabelNext(const char *label);
@@ -342,11 +469,21 @@ public:
 	ArrayVariable *getRootArrayVariable();
 
 	inline void addNumAlias(const char *str, int32_t no) {
-		num_alias.emplace(HashedString(str, true), no);
+		auto &symbol = alias_symbols[internAlias(str)];
+		if (!symbol.has_num) {
+			symbol.num     = no;
+			symbol.has_num = true;
+		}
+		// Compiled expressions may have resolved this name as unknown
+		int_expressions.clear();
 	}
 
 	inline void addStrAlias(const char *str1, const char *str2) {
-		str_alias.emplace(HashedString(str1, true), HashedString(str2, true));
+		auto &symbol = alias_symbols[internAlias(str1)];
+		if (!symbol.has_str) {
+			symbol.str     = str2;
+			symbol.has_str = true;
+		}
 	}
 
 	bool findNumAlias(const char *str, int32_t *value);
@@ -458,18 +595,63 @@ private:
 	int32_t parseArray(const char **buf, ArrayVariable &array);
 	int32_t *getArrayPtr(int32_t no, ArrayVariable &array, int32_t offset);
 
+	// Integer expressions found in the script are compiled into postfix programs on first use.
+	// Every instruction reproduces the side effects parseIntExpression has on current_variable,
+	// so callers cannot tell the difference. Aliases are resolved at compile time.
+	struct IntInstruction {
+		enum Code : uint8_t {
+			Const,     // push value, a literal or an alias
+			Unknown,   // push 0, an unresolved name
+			Clear,     // an unresolved name after an operator, ends the expression
+			Variable,  // pop variable number, push its value
+			Array,     // pop value dimensions and array number, push the element
+			Calc,      // pop two values, push the result
+			CalcUnder, // same as Calc, but for the two values below the top one
+			Negate     // negate the top value
+		};
+		Code code;
+		bool flip;
+		int32_t value; // constant, dimension count or operator
+	};
+	struct IntExpression {
+		std::vector<IntInstruction> program;
+		uint32_t length{0};    // parsed characters
+		uint32_t depth{0};     // stack depth while compiling
+		uint32_t max_depth{0}; // stack depth needed to run
+		void emit(IntInstruction::Code code, int32_t pops, bool flip = false, int32_t value = 0);
+	};
+	static constexpr uint32_t MaxIntExpressionDepth{32};
+	std::unordered_map<const char *, IntExpression> int_expressions;
+	bool compileIntExpression(const char **buf, bool flipSign, IntExpression &expr);
+	bool compileNextOp(const char **buf, Operator *op, IntExpression &expr);
+	bool compileInt(const char **buf, bool flipSign, IntExpression &expr, bool &unknown);
+	bool compileArray(const char **buf, IntExpression &expr);
+	int32_t runIntExpression(const IntExpression &expr);
+
 	/* ---------------------------------------- */
 	/* Variable */
 	VariableData variable_data[VARIABLE_RANGE];
-	struct ExtendedVariableData {
-		uint32_t no;
-		VariableData vd;
-	} * extended_variable_data{nullptr};
-	uint32_t num_extended_variable_data{0};
-	uint32_t max_extended_variable_data{1};
-
-	std::unordered_map<HashedString, int32_t> num_alias;
-	std::unordered_map<HashedString, HashedString> str_alias;
+	// Variables past VARIABLE_RANGE, often used as sparse tables; nodes keep references stable
+	std::unordered_map<uint32_t, VariableData> extended_variable_data;
+
+	// numalias and stralias names are interned once, a symbol holds the values of both kinds.
+	// Alias references in the script remember their symbol, so later visits skip name lookup.
+	struct AliasSymbol {
+		int32_t num{0};
+		bool has_num{false};
+		bool has_str{false};
+		std::string str;
+	};
+	struct AliasReference {
+		uint32_t symbol;
+		uint32_t length; // name characters in the script
+	};
+	std::unordered_map<HashedString, uint32_t> alias_ids;
+	std::vector<AliasSymbol> alias_symbols;
+	std::unordered_map<const char *, AliasReference> alias_references;
+	uint32_t internAlias(const char *name);
+	const AliasReference *findAliasReference(const char *pos);
+	void addAliasReference(const char *pos, const char *name, size_t length);
 
 	ArrayVariable *root_array_variable{nullptr}, *current_array_variable;
 
@@ -479,6 +661,9 @@ private:
 
 	size_t script_buffer_length;
 	char *script_buffer{nullptr};
+	// Offsets of all line breaks in script_buffer, turns line/address conversions into searches
+	std::vector<uint32_t> line_breaks;
+	void indexLines();
 
 	std::string string_buffer;       // updated only by readToken
 	std::string saved_string_buffer; // updated only by saveStringBuffer
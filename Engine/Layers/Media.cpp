@@ -35,7 +35,11 @@ bool MediaLayer::loadVideo(std::string &filename, unsigned audioStream, unsigned
 
 	//Secondly, try to open the video
 	std::unique_ptr<char[]> video_file((*reader)->completePath(filename.c_str(), FileType::File));
-	return media.loadVideo(video_file.get(), audioStream, subtitleStream);
+	if (video_file)
+		return media.loadVideo(video_file.get(), audioStream, subtitleStream);
+
+	//Videos stored in archives are streamed from them
+	return media.loadVideo((*reader)->openStream(filename.c_str()), filename.c_str(), audioStream, subtitleStream);
 }
 
 bool MediaLayer::stopPlayback(FinishMode mode) {
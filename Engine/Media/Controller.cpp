@@ -130,6 +130,20 @@ void MediaProcController::logLine(void *inst, int level, const char *fmt, va_lis
 	sendToLog(iolevel, "[ff %d/0x%x] %s", level, inst, msg);
 }
 
+int MediaProcController::readStream(void *opaque, uint8_t *buf, int bufSize) {
+	auto stream = static_cast<BaseReader::Stream *>(opaque);
+	size_t rd   = stream->read(buf, static_cast<size_t>(bufSize));
+	return rd > 0 ? static_cast<int>(rd) : AVERROR_EOF;
+}
+
+int64_t MediaProcController::seekStream(void *opaque, int64_t offset, int whence) {
+	auto stream = static_cast<BaseReader::Stream *>(opaque);
+	if (whence == AVSEEK_SIZE)
+		return static_cast<int64_t>(stream->size());
+	int64_t pos = stream->seek(offset, whence & ~AVSEEK_FORCE);
+	return pos >= 0 ? pos : AVERROR(EINVAL);
+}
+
 std::unique_ptr<MediaProcController::Decoder> MediaProcController::findDecoder(AVMediaType type, unsigned streamNumber, AVCodecID restrictCodecId) {
 	unsigned stream = 0;
 
@@ -203,6 +217,34 @@ bool MediaProcController::loadVideo(const char *filename, unsigned audioStream,
 	return !hasStream(AudioEntry) || static_cast<AudioDecoder *>(decoders[AudioEntry].get())->initSwrContext(audioSpec);
 }
 
+bool MediaProcController::loadVideo(std::unique_ptr<BaseReader::Stream> stream, const char *filename, unsigned audioStream, unsigned subtitleStream) {
+	if (!stream || !filename) {
+		return false;
+	}
+
+	auto buffer = static_cast<uint8_t *>(av_malloc(StreamBufferSize));
+	if (buffer)
+		streamContext = avio_alloc_context(buffer, static_cast<int>(StreamBufferSize), 0, stream.get(), readStream, nullptr, seekStream);
+	if (!streamContext) {
+		av_free(buffer);
+		return false;
+	}
+	videoStream = std::move(stream);
+
+	formatContext = avformat_alloc_context();
+	if (formatContext) {
+		formatContext->pb = streamContext;
+		// The file name is only used as a format hint from now on
+		if (loadVideo(filename, audioStream, subtitleStream))
+			return true;
+	}
+
+	// Failing to open the input frees the format context, the rest is done in resetState
+	if (!formatContext)
+		resetStream();
+	return false;
+}
+
 bool MediaProcController::loadPresentation(const GPU_Rect &rect, bool loop) {
 	loopVideo = loop;
 
@@ -415,6 +457,17 @@ void MediaProcController::resetState() {
 
 	if (formatContext)
 		avformat_close_input(&formatContext);
+
+	resetStream();
+}
+
+void MediaProcController::resetStream() {
+	// Custom io contexts are not freed by ffmpeg
+	if (streamContext) {
+		av_freep(&streamContext->buffer);
+		av_freep(&streamContext);
+	}
+	videoStream.reset();
 }
 
 void MediaProcController::decodeFrames(MediaEntries entry) {
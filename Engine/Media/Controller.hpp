@@ -306,15 +306,21 @@ private:
 #endif
 	static constexpr size_t AudioPacketBufferSize = VideoPacketBufferSize * 2;
 
+	static constexpr size_t StreamBufferSize = 64 * 1024;
+
 	static int lockManager(void **mutex, AVLockOp op);
 	static void logLine(void *inst, int level, const char *fmt, va_list args);
+	static int readStream(void *opaque, uint8_t *buf, int bufSize);
+	static int64_t seekStream(void *opaque, int64_t offset, int whence);
 
 	std::unique_ptr<Decoder> findDecoder(AVMediaType type, unsigned streamNumber = 1, AVCodecID restrictCodecId = AV_CODEC_ID_NONE);
 
 	AudioSpec audioSpec;
 	std::unique_ptr<TempImagePool> imagePool{nullptr}; // image pool of SDL_Surfaces for video frames
 
-	AVFormatContext *formatContext{nullptr}; // ff format context
+	AVFormatContext *formatContext{nullptr};         // ff format context
+	AVIOContext *streamContext{nullptr};             // ff io context over videoStream when not read from a file
+	std::unique_ptr<BaseReader::Stream> videoStream; // reader stream the video is read from
 
 	SDL_semaphore *frameQueueSem[2]{nullptr, nullptr}; // semaphores used to control async..results queue size (VideoFrames)
 	SDL_mutex *frameQueuemutex[2]{nullptr, nullptr};   // mutexes used to control frame decoding execution
@@ -336,10 +342,12 @@ private:
 
 	void resetDemuxer();
 	void resetDecoders();
+	void resetStream();
 	void resetFrameQueues(int vidStart = 0, int vidEnd = 0);
 
 public:
 	bool loadVideo(const char *filename, unsigned audioStream, unsigned subtitleStream);
+	bool loadVideo(std::unique_ptr<BaseReader::Stream> stream, const char *filename, unsigned audioStream, unsigned subtitleStream);
 	bool loadPresentation(const GPU_Rect &rect, bool loop);
 	void frameSize(const SDL_Rect &rect, int &width, float &wFactor, int &height, float &hFactor, bool alpha);
 	bool addSubtitles(const char *filename, int frameWidth, int frameHeight);
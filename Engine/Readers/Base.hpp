@@ -12,45 +12,133 @@
 #include "External/Compatibility.hpp"
 #include "Support/FileDefs.hpp"
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <string>
 #include <cstdint>
 #include <cstdio>
 
+#ifdef LINUX
+#include <sys/mman.h>
+#endif
+
 class BaseReader {
 public:
 	enum {
 		ARCHIVE_TYPE_NONE = 0,
 		ARCHIVE_TYPE_SAR  = 1,
 		ARCHIVE_TYPE_NSA  = 2,
-		ARCHIVE_TYPE_NS2  = 3 //new format since NScr2.91, uses ext ".ns2"
+		ARCHIVE_TYPE_NS2  = 3, //new format since NScr2.91, uses ext ".ns2"
+		ARCHIVE_TYPE_NSX  = 4  //indexed archive with a hashed table of contents, uses ext ".nsx"
 	};
 
-	struct FileInfo {
-		char name[PATH_MAX]{};
-		size_t offset{0};
-		size_t length{0};
-		size_t original_length{0};
+	enum {
+		NO_COMPRESSION   = 0,
+		SPB_COMPRESSION  = 1,
+		LZSS_COMPRESSION = 2,
+		NBZ_COMPRESSION  = 4,
+		ZLIB_COMPRESSION = 8 // only used by indexed archives
+	};
+
+	// Archive entries kept as parallel arrays for compactness,
+	// names are references into the name pool of the owning reader
+	struct FileTable {
+		std::vector<uint32_t> names;
+		std::vector<size_t> offsets;
+		std::vector<uint32_t> lengths;
+		std::vector<uint32_t> original_lengths;
+		std::vector<uint8_t> compression_types;
+
+		size_t size() const {
+			return offsets.size();
+		}
+		void reserve(size_t num) {
+			names.reserve(num);
+			offsets.reserve(num);
+			lengths.reserve(num);
+			original_lengths.reserve(num);
+			compression_types.reserve(num);
+		}
+		void add(uint32_t name, size_t offset, uint32_t length, uint32_t original_length, uint8_t compression_type = NO_COMPRESSION) {
+			names.emplace_back(name);
+			offsets.emplace_back(offset);
+			lengths.emplace_back(length);
+			original_lengths.emplace_back(original_length);
+			compression_types.emplace_back(compression_type);
+		}
 	};
 
 	struct ArchiveInfo {
 		ArchiveInfo *next{nullptr};
 		FILE *file_handle{nullptr};
 		char *file_name{nullptr};
-		FileInfo *fi_list{nullptr};
-		size_t num_of_files{0};
+		FileTable files;
+		std::vector<uint32_t> checksums; // CRC-32 of the original data per entry, when the format provides them
 		size_t base_offset{0};
+		uint8_t *mapping{nullptr}; // read-only view of the whole archive when memory-mapped
+		size_t mapping_length{0};
 		ArchiveInfo()                    = default;
 		ArchiveInfo(const ArchiveInfo &) = delete;
 		ArchiveInfo operator=(const ArchiveInfo &) = delete;
 		~ArchiveInfo() {
+#ifdef LINUX
+			if (mapping)
+				munmap(mapping, mapping_length);
+#endif
 			if (file_handle)
 				std::fclose(file_handle);
 			delete[] file_name;
-			delete[] fi_list;
 		}
 	};
 
+	// Seekable read-only stream over a single file, allows consuming large resources
+	// without reading them into memory at once. Streams keep their own position and
+	// may be read from any thread, but must not outlive the reader that opened them.
+	class Stream {
+	public:
+		explicit Stream(size_t len)
+		    : length(len) {}
+		Stream(const Stream &) = delete;
+		Stream &operator=(const Stream &) = delete;
+		virtual ~Stream()                 = default;
+
+		size_t size() const {
+			return length;
+		}
+		size_t tell() const {
+			return position;
+		}
+		// Same semantics as fseek, except that the new position is returned (-1 on failure)
+		int64_t seek(int64_t offset, int whence) {
+			if (whence == SEEK_CUR)
+				offset += static_cast<int64_t>(position);
+			else if (whence == SEEK_END)
+				offset += static_cast<int64_t>(length);
+			else if (whence != SEEK_SET)
+				return -1;
+			if (offset < 0 || static_cast<size_t>(offset) > length)
+				return -1;
+			position = static_cast<size_t>(offset);
+			return offset;
+		}
+		size_t read(void *buffer, size_t len) {
+			len = std::min(len, length - position);
+			if (len > 0)
+				len = readAt(position, static_cast<uint8_t *>(buffer), len);
+			position += len;
+			return len;
+		}
+
+	protected:
+		// Reads len bytes at pos, which is guaranteed to be within the file, returns the amount read
+		virtual size_t readAt(size_t pos, uint8_t *buffer, size_t len) = 0;
+
+	private:
+		size_t length;
+		size_t position{0};
+	};
+
 	BaseReader()                   = default;
 	BaseReader(const BaseReader &) = delete;
 	BaseReader &operator=(const BaseReader &) = delete;
@@ -66,5 +154,17 @@ public:
 	virtual bool getFile(const char *file_name, size_t &len, uint8_t **buffer = nullptr)   = 0;
 	virtual bool getFile(const char *file_name, size_t &len, std::vector<uint8_t> &buffer) = 0;
 
+	// Zero-copy interface, only succeeds for files residing in memory-mapped archives.
+	// The returned buffer is read-only, not null-terminated, and valid until the reader is closed.
+	// Callers are expected to fall back to getFile on failure.
+	virtual bool getFileView(const char * /*file_name*/, size_t & /*len*/, const uint8_t ** /*buffer*/) {
+		return false;
+	}
+
+	// Streaming interface, returns nullptr when the file cannot be found
+	virtual std::unique_ptr<Stream> openStream(const char * /*file_name*/) {
+		return nullptr;
+	}
+
 	virtual char *completePath(const char *path, FileType type = FileType::Any, size_t *len = nullptr) = 0;
 };
@@ -14,11 +14,124 @@
 
 #include <algorithm>
 #include <string>
+#include <cctype>
+
+#ifdef LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+bool DirectReader::file_watching{false};
+
+DirectReader::DirectReader(DirPaths &path)
+    : archive_path(path) {
+	// Snapshot the top level directories right away, subdirectories are listed on first access
+	for (size_t n = 0, sz = archive_path.getPathNum(); n < sz; n++)
+		snapshotContains(archive_path.getPath(n));
+}
+
+DirectReader::~DirectReader() {
+#ifdef LINUX
+	if (watch_fd >= 0)
+		::close(watch_fd);
+#endif
+}
+
+void DirectReader::setFileWatching(bool on) {
+	file_watching = on;
+}
+
+bool DirectReader::snapshotContains(const std::string &path) {
+#ifdef WIN32
+	size_t pos = path.find_last_of("\\/");
+#else
+	size_t pos = path.find_last_of(DELIMITER);
+#endif
+	std::string dir  = pos == std::string::npos ? CURRENT_REL_PATH : path.substr(0, pos + 1);
+	std::string name = pos == std::string::npos ? path : path.substr(pos + 1);
+
+	auto it = dir_snapshots.find(dir);
+	if (it == dir_snapshots.end()) {
+		std::unordered_set<std::string> entries;
+		for (auto &entry : FileIO::scanDir(dir)) {
+			std::transform(entry.begin(), entry.end(), entry.begin(), ::tolower);
+			entries.emplace(std::move(entry));
+		}
+#ifdef LINUX
+		if (file_watching) {
+			if (watch_fd < 0)
+				watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			int wd = watch_fd >= 0 ? inotify_add_watch(watch_fd, dir.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF) : -1;
+			if (wd >= 0)
+				watched_dirs[wd] = dir;
+		}
+#endif
+		it = dir_snapshots.emplace(std::move(dir), std::move(entries)).first;
+	}
+
+	// Nothing to look up when snapshotting a directory itself
+	if (name.empty())
+		return true;
+
+	std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+	return it->second.count(name) > 0;
+}
+
+void DirectReader::processWatchEvents() {
+#ifdef LINUX
+	if (watch_fd < 0)
+		return;
+
+	alignas(inotify_event) char buf[4096];
+	ssize_t len;
+	while ((len = read(watch_fd, buf, sizeof(buf))) > 0) {
+		for (ssize_t off = 0; off < len;) {
+			auto event = reinterpret_cast<inotify_event *>(buf + off);
+			if (event->mask & IN_Q_OVERFLOW) {
+				dir_snapshots.clear();
+			} else {
+				auto it = watched_dirs.find(event->wd);
+				if (it != watched_dirs.end())
+					dir_snapshots.erase(it->second);
+			}
+			off += sizeof(inotify_event) + event->len;
+		}
+		missing_files.clear();
+	}
+#endif
+}
+
+static bool isPlainAscii(const std::string &str) {
+	return std::all_of(str.begin(), str.end(), [](char ch) { return static_cast<uint8_t>(ch) < 0x80; });
+}
+
+bool DirectReader::isKnownMissing(const char *path) {
+	Lock lock(&missing_files);
+
+	processWatchEvents();
+
+	std::string name(path);
+	if (missing_files.count(name))
+		return true;
+
+	for (size_t n = 0, sz = archive_path.getPathNum(); n < sz; n++) {
+		auto fpath = archive_path.getPath(n) + name;
+		// Snapshots are only trusted for plain ASCII paths, as filesystems may normalise anything else
+		if (!isPlainAscii(fpath) || snapshotContains(fpath))
+			return false;
+	}
+
+	missing_files.emplace(std::move(name));
+	return true;
+}
 
 FILE *DirectReader::lookupFile(const char *path, const char *mode) {
 	FILE *fp  = nullptr;
 	size_t sz = archive_path.getPathNum();
 
+	if (isKnownMissing(path))
+		return nullptr;
+
 #ifdef WIN32
 	// Attempt to go fast path on Windows if possible
 	bool unicode = hasUnicode(path, std::strlen(path));
@@ -40,10 +153,42 @@ bool DirectReader::getFile(const char *file_name, size_t &len, std::vector<uint8
 	return FileIO::readFile(lookupFile(file_name, "rb"), len, buffer, true);
 }
 
+// Streams a loose file through its own handle, so no locking is needed
+class DirectReader::FileStream : public Stream {
+public:
+	FileStream(FILE *fp, size_t len)
+	    : Stream(len), file_handle(fp) {}
+	~FileStream() override {
+		std::fclose(file_handle);
+	}
+
+protected:
+	size_t readAt(size_t pos, uint8_t *buffer, size_t len) override {
+		if (FileIO::seekFile(file_handle, pos, SEEK_SET))
+			return 0;
+		return std::fread(buffer, 1, len, file_handle);
+	}
+
+private:
+	FILE *file_handle;
+};
+
+std::unique_ptr<BaseReader::Stream> DirectReader::openStream(const char *file_name) {
+	FILE *fp = lookupFile(file_name, "rb");
+	size_t len{0};
+	if (!FileIO::readFile(fp, len, nullptr))
+		return nullptr;
+
+	return std::make_unique<FileStream>(fp, len);
+}
+
 char *DirectReader::completePath(const char *path, FileType type, size_t *len) {
 	size_t sz = archive_path.getPathNum();
 	std::string fpath(path);
 
+	if (type != FileType::URL && isKnownMissing(path))
+		return nullptr;
+
 #ifdef WIN32
 	// Attempt to go fast path on Windows if possible
 	bool unicode = hasUnicode(path, std::strlen(path));
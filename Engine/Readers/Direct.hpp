@@ -15,12 +15,14 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <cstring>
 
 class DirectReader : public BaseReader {
 public:
-	DirectReader(DirPaths &path)
-	    : archive_path(path) {}
+	DirectReader(DirPaths &path);
+	~DirectReader() override;
 
 	int open(const char *name) override;
 	int close() override;
@@ -30,11 +32,31 @@ public:
 
 	bool getFile(const char *file_name, size_t &len, uint8_t **buffer) override;
 	bool getFile(const char *file_name, size_t &len, std::vector<uint8_t> &buffer) override;
+	std::unique_ptr<Stream> openStream(const char *file_name) override;
 	char *completePath(const char *path, FileType type, size_t *len) override;
 
+	// Invalidate directory snapshots on filesystem changes (only supported on Linux)
+	static void setFileWatching(bool on);
+
 protected:
+	class FileStream;
+
 	DirPaths &archive_path;
 
+	// Case-folded directory listings by directory path, used to avoid probing for absent files
+	std::unordered_map<std::string, std::unordered_set<std::string>> dir_snapshots;
+	// Relative paths known to be absent in every archive_path directory
+	std::unordered_set<std::string> missing_files;
+#ifdef LINUX
+	int watch_fd{-1};
+	std::unordered_map<int, std::string> watched_dirs;
+#endif
+	static bool file_watching;
+
+	bool isKnownMissing(const char *path);
+	bool snapshotContains(const std::string &path);
+	void processWatchEvents();
+
 	uint8_t read8(FILE *fp);
 	uint16_t read16(FILE *fp);
 	uint32_t read32(FILE *fp);
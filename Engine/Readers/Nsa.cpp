@@ -17,9 +17,10 @@ NsaReader::NsaReader(DirPaths &path, size_t nsaoffset)
     : SarReader(path) {
 	sar_flag            = true;
 	nsa_offset          = nsaoffset;
-	num_of_nsa_archives = num_of_ns2_archives = 0;
-	nsa_archive_ext                           = "nsa";
-	ns2_archive_ext                           = "ns2";
+	num_of_nsa_archives = num_of_ns2_archives = num_of_nsx_archives = 0;
+	nsa_archive_ext                                                 = "nsa";
+	ns2_archive_ext                                                 = "ns2";
+	nsx_archive_ext                                                 = "nsx";
 }
 
 NsaReader::~NsaReader() = default;
@@ -63,41 +64,81 @@ int NsaReader::processArchives(const DirPaths &nsa_path) {
 		}
 	}
 
-	bool has_ns2 = false;
+	num_of_ns2_archives = openNumberedArchives(nsa_path, ns2_archive_ext, archive_info_ns2, MAX_NS2_ARCHIVE, ARCHIVE_TYPE_NS2);
+	num_of_nsx_archives = openNumberedArchives(nsa_path, nsx_archive_ext, archive_info_nsx, MAX_NSX_ARCHIVE, ARCHIVE_TYPE_NSX);
+
+	if (num_of_nsa_paths == 0 && num_of_ns2_archives == 0 && num_of_nsx_archives == 0) {
+		// didn't find any (main) archive files
+		sendToLog(LogLevel::Error, "can't open nsa archive file %s.%s ns2_archive_ext\n", NSA_ARCHIVE_NAME, nsa_archive_ext, ns2_archive_ext);
+		return -1;
+	}
+
+	buildFileIndex();
+
+	return 0;
+}
+
+size_t NsaReader::openNumberedArchives(const DirPaths &nsa_path, const char *ext, ArchiveInfo *infos, size_t max_num, int archive_type) {
+	char archive_name[PATH_MAX];
+	size_t num_of_nsa_paths = nsa_path.getPathNum();
+	bool has_first          = false;
 
 	for (size_t nd = 0; nd < num_of_nsa_paths; nd++) {
-		std::snprintf(archive_name, PATH_MAX, "%s00.%s", nsa_path.getPath(nd), ns2_archive_ext);
+		std::snprintf(archive_name, PATH_MAX, "%s00.%s", nsa_path.getPath(nd), ext);
 		size_t length;
 		if (DirectReader::getFile(archive_name, length, nullptr)) {
-			has_ns2 = true;
+			has_first = true;
 			break;
 		}
 	}
 
-	if (has_ns2) {
-		for (size_t i = MAX_NS2_ARCHIVE; i > 0; i--) {
-			FILE *fp = nullptr;
-			for (size_t nd = 0; nd < num_of_nsa_paths; nd++) {
-				std::snprintf(archive_name, PATH_MAX, "%s%02zu.%s", nsa_path.getPath(nd), i - 1, ns2_archive_ext);
-				fp = FileIO::openFile(archive_name, "rb");
-				if (fp) {
-					archive_info_ns2[num_of_ns2_archives].file_handle = fp;
-					archive_info_ns2[num_of_ns2_archives].file_name   = copystr(archive_name);
-					readArchive(&archive_info_ns2[num_of_ns2_archives], ARCHIVE_TYPE_NS2);
-					num_of_ns2_archives++;
-					break;
-				}
+	if (!has_first)
+		return 0;
+
+	// Archives with higher numbers come first, so that they take priority
+	size_t num = 0;
+	for (size_t i = max_num; i > 0; i--) {
+		FILE *fp = nullptr;
+		for (size_t nd = 0; nd < num_of_nsa_paths; nd++) {
+			std::snprintf(archive_name, PATH_MAX, "%s%02zu.%s", nsa_path.getPath(nd), i - 1, ext);
+			fp = FileIO::openFile(archive_name, "rb");
+			if (fp) {
+				infos[num].file_handle = fp;
+				infos[num].file_name   = copystr(archive_name);
+				readArchive(&infos[num], archive_type);
+				num++;
+				break;
 			}
 		}
 	}
 
-	if (num_of_nsa_paths == 0 && num_of_ns2_archives == 0) {
-		// didn't find any (main) archive files
-		sendToLog(LogLevel::Error, "can't open nsa archive file %s.%s ns2_archive_ext\n", NSA_ARCHIVE_NAME, nsa_archive_ext, ns2_archive_ext);
-		return -1;
+	return num;
+}
+
+void NsaReader::buildFileIndex() {
+	// Archives are indexed in lookup priority order: nsx, ns2, arc.nsa, arc?.nsa, and sar last
+	clearFileIndex();
+
+	for (size_t i = 0; i < num_of_nsx_archives; i++)
+		indexArchive(&archive_info_nsx[i]);
+
+	for (size_t i = 0; i < num_of_ns2_archives; i++)
+		indexArchive(&archive_info_ns2[i]);
+
+	indexArchive(&archive_info_nsa);
+
+	if (num_of_nsa_archives > 0) {
+		for (size_t i = 0; i < num_of_nsa_archives - 1; i++)
+			indexArchive(&archive_info2[i]);
 	}
 
-	return 0;
+	if (sar_flag) {
+		ArchiveInfo *info = archive_info.next;
+		for (size_t i = 0; i < num_of_sar_archives; i++) {
+			indexArchive(info);
+			info = info->next;
+		}
+	}
 }
 
 const char *NsaReader::getArchiveName() const {
@@ -105,26 +146,20 @@ const char *NsaReader::getArchiveName() const {
 }
 
 size_t NsaReader::getNumFiles() {
-	size_t total = archive_info.num_of_files; // start with sar files, if any
+	size_t total = archive_info.files.size(); // start with sar files, if any
 
-	total += archive_info_nsa.num_of_files; // add in the arc.nsa files
+	total += archive_info_nsa.files.size(); // add in the arc.nsa files
 
 	for (size_t i = 0; i < num_of_nsa_archives - 1; i++)
-		total += archive_info2[i].num_of_files; // add in the arc?.nsa files
+		total += archive_info2[i].files.size(); // add in the arc?.nsa files
 
 	for (size_t i = 0; i < num_of_ns2_archives; i++)
-		total += archive_info_ns2[i].num_of_files; // add in the ##.ns2 files
-
-	return total;
-}
+		total += archive_info_ns2[i].files.size(); // add in the ##.ns2 files
 
-size_t NsaReader::getFileLengthSub(ArchiveInfo *ai, const char *file_name) {
-	size_t i = getIndexFromFile(ai, file_name);
+	for (size_t i = 0; i < num_of_nsx_archives; i++)
+		total += archive_info_nsx[i].files.size(); // add in the ##.nsx files
 
-	if (i == ai->num_of_files)
-		return 0;
-
-	return ai->fi_list[i].original_length;
+	return total;
 }
 
 bool NsaReader::getFile(const char *file_name, size_t &len, uint8_t **buffer) {
@@ -132,27 +167,10 @@ bool NsaReader::getFile(const char *file_name, size_t &len, uint8_t **buffer) {
 	if (DirectReader::getFile(file_name, len, buffer))
 		return true;
 
-	// ns2 read
-	for (size_t i = 0; i < num_of_ns2_archives; i++) {
-		if (getFileSub(&archive_info_ns2[i], file_name, len, buffer))
-			return true;
-	}
-
-	// nsa read
-	if (getFileSub(&archive_info_nsa, file_name, len, buffer))
-		return true;
-
-	// nsa? read
-	if (num_of_nsa_archives > 0) {
-		for (size_t i = 0; i < num_of_nsa_archives - 1; i++) {
-			if (getFileSub(&archive_info2[i], file_name, len, buffer))
-				return true;
-		}
-	}
-
-	// sar read
-	if (sar_flag)
-		return SarReader::getFile(file_name, len, buffer);
+	// nsx, ns2, nsa, nsa? and sar read
+	FileIndexEntry entry;
+	if (findFileEntry(file_name, entry))
+		return getFileSub(entry.ai, entry.index, len, buffer);
 
 	return false;
 }
@@ -14,6 +14,7 @@
 
 #define MAX_EXTRA_ARCHIVE 9
 #define MAX_NS2_ARCHIVE 100
+#define MAX_NSX_ARCHIVE 100
 #define NSA_ARCHIVE_NAME "arc"
 
 class NsaReader : public SarReader {
@@ -35,11 +36,15 @@ private:
 	size_t nsa_offset;
 	size_t num_of_nsa_archives;
 	size_t num_of_ns2_archives;
+	size_t num_of_nsx_archives;
 	const char *nsa_archive_ext;
 	const char *ns2_archive_ext;
+	const char *nsx_archive_ext;
 	struct ArchiveInfo archive_info_nsa;                  // for the arc.nsa file
 	struct ArchiveInfo archive_info2[MAX_EXTRA_ARCHIVE];  // for the arc1.nsa, arc2.nsa files
 	struct ArchiveInfo archive_info_ns2[MAX_NS2_ARCHIVE]; // for the ##.ns2 files
+	struct ArchiveInfo archive_info_nsx[MAX_NSX_ARCHIVE]; // for the ##.nsx files
 
-	size_t getFileLengthSub(ArchiveInfo *ai, const char *file_name);
+	size_t openNumberedArchives(const DirPaths &nsa_path, const char *ext, ArchiveInfo *infos, size_t max_num, int archive_type);
+	void buildFileIndex();
 };
@@ -8,8 +8,25 @@
  */
 
 #include "Engine/Readers/Sar.hpp"
+#include "Engine/Components/Async.hpp"
 #include "Support/FileIO.hpp"
 
+#include <bzlib.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#ifdef LINUX
+#include <sys/stat.h>
+#endif
+
+#ifndef WIN32
+#include <unistd.h>
+#include <cerrno>
+#endif
+
 SarReader::SarReader(DirPaths &path)
     : DirectReader(path) {
 	root_archive_info = last_archive_info = &archive_info;
@@ -32,6 +49,7 @@ int SarReader::open(const char *name) {
 	std::memcpy(info->file_name, name, strlen(name) + 1);
 
 	readArchive(info);
+	indexArchive(info);
 
 	last_archive_info->next = info;
 	last_archive_info       = last_archive_info->next;
@@ -40,12 +58,57 @@ int SarReader::open(const char *name) {
 	return 0;
 }
 
+static uint16_t readBE16(const uint8_t *buf) {
+	return static_cast<uint16_t>(buf[0] << 8 | buf[1]);
+}
+
+static uint32_t readBE32(const uint8_t *buf) {
+	return static_cast<uint32_t>(buf[0]) << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
+}
+
+static uint32_t readLE32(const uint8_t *buf) {
+	return static_cast<uint32_t>(buf[3]) << 24 | buf[2] << 16 | buf[1] << 8 | buf[0];
+}
+
+static uint64_t readLE64(const uint8_t *buf) {
+	return static_cast<uint64_t>(readLE32(buf + 4)) << 32 | readLE32(buf);
+}
+
+static size_t upcaseName(uint8_t *name) {
+	size_t len = 0;
+	for (; name[len]; len++) {
+		if ('a' <= name[len] && name[len] <= 'z')
+			name[len] += 'A' - 'a';
+	}
+	return len;
+}
+
+static uint32_t hashName(const char *name, size_t len) {
+	// FNV-1a
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= static_cast<uint8_t>(name[i]);
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
 int SarReader::readArchive(ArchiveInfo *ai, int archive_type, size_t offset) {
-	unsigned int i = 0;
+	if (archive_type == ARCHIVE_TYPE_NSX)
+		return readIndexedArchive(ai, offset);
 
-	/* Read header */
-	for (size_t j = 0; j < offset; j++)
-		read8(ai->file_handle);
+	// The header is read at once and parsed in place, only the entry table is retained
+	std::vector<uint8_t> hdr;
+	size_t prefix_size = archive_type == ARCHIVE_TYPE_NS2 ? 4 : 6;
+
+	hdr.resize(prefix_size);
+	if (FileIO::seekFile(ai->file_handle, offset, SEEK_SET) ||
+	    std::fread(hdr.data(), prefix_size, 1, ai->file_handle) != 1) {
+		sendToLog(LogLevel::Error, "Failed to read the header of %s\n", ai->file_name);
+		return -1;
+	}
+
+	size_t num_of_files = 0;
 	if (archive_type == ARCHIVE_TYPE_NS2) {
 		// new archive type since NScr2.91
 		// - header starts with base_offset (byte-swapped), followed by
@@ -54,89 +117,213 @@ int SarReader::readArchive(ArchiveInfo *ai, int archive_type, size_t offset) {
 		// - new NS2 filename def: "filename", length (4bytes, swapped)
 		// - no compression type? really, no compression.
 		// - not sure if NS2 uses key_table or not, using default funcs for now
-		ai->base_offset = swap32(read32(ai->file_handle));
-		ai->base_offset += offset;
+		ai->base_offset = readLE32(hdr.data()) + offset;
+	} else {
+		// old NSA filename def: filename, ending '\0' byte , compr-type byte,
+		// start (4byte), length (4byte))
+		num_of_files    = readBE16(hdr.data());
+		ai->base_offset = readBE32(hdr.data() + 2) + offset;
+	}
+
+	size_t hdr_size = ai->base_offset - offset;
+	if (ai->base_offset < offset || hdr_size < prefix_size) {
+		sendToLog(LogLevel::Error, "%s does not seem to be a valid archive\n", ai->file_name);
+		return -1;
+	}
+
+	// Reserve an extra byte to terminate the last name in a damaged header
+	hdr.resize(hdr_size + 1);
+	hdr[hdr_size] = '\0';
+	if (hdr_size > prefix_size && std::fread(hdr.data() + prefix_size, hdr_size - prefix_size, 1, ai->file_handle) != 1) {
+		sendToLog(LogLevel::Error, "Failed to read the header of %s\n", ai->file_name);
+		return -1;
+	}
 
-		// need to parse the whole header to see how many files there are
-		ai->num_of_files  = 0;
-		size_t cur_offset = offset + 5;
+	size_t pos = prefix_size;
+	if (archive_type == ARCHIVE_TYPE_NS2) {
+		size_t cur_offset = ai->base_offset;
 		// there's an extra byte at the end of the header, not sure what for
-		while (cur_offset < ai->base_offset) {
-			//skip the beginning double-quote
-			cur_offset++;
-			do
-				cur_offset++;
-			while (std::fgetc(ai->file_handle) != '"');
-			read32(ai->file_handle);
-			cur_offset += 4;
-			ai->num_of_files++;
-		}
-		ai->fi_list = new FileInfo[ai->num_of_files];
-
-		// now go back to the beginning and read the file info
-		cur_offset = ai->base_offset;
-		FileIO::seekFile(ai->file_handle, 4 + offset, SEEK_SET);
-		for (i = 0; i < ai->num_of_files; i++) {
-			unsigned int count = 0;
-			//skip the beginning double-quote
-			uint8_t ch = std::fgetc(ai->file_handle);
+		while (pos + 1 < hdr_size) {
 			//error if _not_ a double-quote
-			if (ch != '"') {
+			if (hdr[pos] != '"') {
 				sendToLog(LogLevel::Error, "file does not seem to be a valid NS2 archive\n");
 				return -1;
 			}
-			while ((ch = std::fgetc(ai->file_handle)) != '"') {
-				if ('a' <= ch && ch <= 'z')
-					ch += 'A' - 'a';
-				ai->fi_list[i].name[count++] = ch;
-			}
-			ai->fi_list[i].name[count]     = '\0';
-			ai->fi_list[i].offset          = cur_offset;
-			ai->fi_list[i].length          = swap32(read32(ai->file_handle));
-			ai->fi_list[i].original_length = ai->fi_list[i].length;
-			cur_offset += ai->fi_list[i].length;
-		}
-		//
-		// old NSA filename def: filename, ending '\0' byte , compr-type byte,
-		// start (4byte), length (4byte))
-	} else {
-		ai->num_of_files = read16(ai->file_handle);
-		ai->fi_list      = new struct FileInfo[ai->num_of_files];
 
-		ai->base_offset = read32(ai->file_handle);
-		ai->base_offset += offset;
+			size_t name_pos = ++pos;
+			while (pos < hdr_size && hdr[pos] != '"') pos++;
+			if (pos + 5 > hdr_size) {
+				sendToLog(LogLevel::Error, "file does not seem to be a valid NS2 archive\n");
+				return -1;
+			}
+			hdr[pos]        = '\0';
+			size_t name_len = upcaseName(&hdr[name_pos]);
+			uint32_t length = readLE32(&hdr[pos + 1]);
 
-		for (i = 0; i < ai->num_of_files; i++) {
-			uint8_t ch;
-			int count = 0;
+			ai->files.add(internName(reinterpret_cast<const char *>(&hdr[name_pos]), name_len), cur_offset, length, length);
+			cur_offset += length;
 
-			while ((ch = std::fgetc(ai->file_handle))) {
-				if ('a' <= ch && ch <= 'z')
-					ch += 'A' - 'a';
-				ai->fi_list[i].name[count++] = ch;
+			pos += 5;
+		}
+	} else {
+		size_t entry_size = archive_type == ARCHIVE_TYPE_NSA ? 13 : 8;
+		ai->files.reserve(num_of_files);
+
+		for (size_t i = 0; i < num_of_files; i++) {
+			size_t name_pos = pos;
+			while (pos < hdr_size && hdr[pos]) pos++;
+			if (pos + 1 + entry_size > hdr_size) {
+				sendToLog(LogLevel::Error, "%s has a truncated header\n", ai->file_name);
+				return -1;
 			}
-			ai->fi_list[i].name[count] = ch;
+			size_t name_len = upcaseName(&hdr[name_pos]);
+			auto name       = reinterpret_cast<const char *>(&hdr[name_pos]);
+			pos++;
 
-			if (archive_type == ARCHIVE_TYPE_NSA && read8(ai->file_handle) != 0) {
-				sendToLog(LogLevel::Error, "Reading of %s might fail due to compression.\n"
-				                           "Refrain from using any compression on media files!\n",
-				          ai->fi_list[i].name);
+			uint8_t compression_type = NO_COMPRESSION;
+			if (archive_type == ARCHIVE_TYPE_NSA) {
+				compression_type = hdr[pos++];
+				if (compression_type != NO_COMPRESSION && compression_type != SPB_COMPRESSION &&
+				    compression_type != LZSS_COMPRESSION && compression_type != NBZ_COMPRESSION) {
+					sendToLog(LogLevel::Error, "Unsupported compression type %u of %s, reading it as is\n",
+					          compression_type, name);
+					compression_type = NO_COMPRESSION;
+				}
 			}
 
-			ai->fi_list[i].offset = read32(ai->file_handle) + ai->base_offset;
-			ai->fi_list[i].length = read32(ai->file_handle);
+			size_t offset   = readBE32(&hdr[pos]) + ai->base_offset;
+			uint32_t length = readBE32(&hdr[pos + 4]);
+			pos += 8;
 
+			uint32_t original_length = length;
 			if (archive_type == ARCHIVE_TYPE_NSA) {
-				ai->fi_list[i].original_length = read32(ai->file_handle);
-			} else {
-				ai->fi_list[i].original_length = ai->fi_list[i].length;
+				original_length = readBE32(&hdr[pos]);
+				pos += 4;
 			}
+
+			ai->files.add(internName(name, name_len), offset, length, original_length, compression_type);
 		}
 	}
 
+	mapArchive(ai);
+
 	return 0;
 }
 
+// Indexed archive layout, all numbers are little endian:
+// - header (32 bytes): "NSXA", version, number of entries, size of the name block,
+//   data alignment, CRC-32 of the table of contents, 8 reserved bytes;
+// - table of contents: entries sorted by name (32 bytes each: FNV-1a hash of the name,
+//   name offset within the name block, data offset (8 bytes), stored length, original length,
+//   CRC-32 of the original data, compression type, 3 reserved bytes), followed by the name block
+//   with null-terminated upper-case names using backslashes;
+// - entry data, each entry aligned to the data alignment.
+int SarReader::readIndexedArchive(ArchiveInfo *ai, size_t offset) {
+	constexpr size_t HeaderSize = 32;
+	constexpr size_t EntrySize  = 32;
+
+	uint8_t hdr[HeaderSize];
+	FileIO::seekFile(ai->file_handle, offset, SEEK_SET);
+	if (std::fread(hdr, HeaderSize, 1, ai->file_handle) != 1 || std::memcmp(hdr, "NSXA", 4)) {
+		sendToLog(LogLevel::Error, "%s does not seem to be a valid archive\n", ai->file_name);
+		return -1;
+	}
+
+	if (readLE32(hdr + 4) != 1) {
+		sendToLog(LogLevel::Error, "%s has unsupported version %u\n", ai->file_name, readLE32(hdr + 4));
+		return -1;
+	}
+
+	size_t num_of_files = readLE32(hdr + 8);
+	size_t names_size   = readLE32(hdr + 12);
+
+	// Header values are checked against the file before anything is allocated for them
+	size_t file_size{0};
+	FileIO::readFile(ai->file_handle, file_size, static_cast<uint8_t **>(nullptr));
+	size_t available = file_size > offset + HeaderSize ? file_size - offset - HeaderSize : 0;
+	if (num_of_files > available / EntrySize || names_size > available - num_of_files * EntrySize) {
+		sendToLog(LogLevel::Error, "%s is truncated or has a damaged header\n", ai->file_name);
+		return -1;
+	}
+	size_t toc_size = num_of_files * EntrySize + names_size;
+
+	// The table of contents follows the header and is read at once
+	std::vector<uint8_t> toc(toc_size + 1);
+	if (toc_size > 0 && std::fread(toc.data(), toc_size, 1, ai->file_handle) != 1) {
+		sendToLog(LogLevel::Error, "Failed to read the header of %s\n", ai->file_name);
+		return -1;
+	}
+	if (crc32(0, toc.data(), static_cast<uInt>(toc_size)) != readLE32(hdr + 20)) {
+		sendToLog(LogLevel::Error, "%s has a damaged table of contents\n", ai->file_name);
+		return -1;
+	}
+	toc[toc_size] = '\0';
+
+	auto names = reinterpret_cast<const char *>(&toc[num_of_files * EntrySize]);
+	ai->base_offset = offset;
+	ai->files.reserve(num_of_files);
+	ai->checksums.reserve(num_of_files);
+
+	for (size_t i = 0; i < num_of_files; i++) {
+		const uint8_t *entry = &toc[i * EntrySize];
+		size_t name_offset   = readLE32(entry + 4);
+		if (name_offset >= names_size) {
+			sendToLog(LogLevel::Error, "%s has a damaged table of contents\n", ai->file_name);
+			return -1;
+		}
+
+		uint8_t compression_type;
+		switch (entry[28]) {
+			case 0:
+				compression_type = NO_COMPRESSION;
+				break;
+			case 1:
+				compression_type = ZLIB_COMPRESSION;
+				break;
+			default:
+				sendToLog(LogLevel::Error, "Unsupported compression type %u of %s\n", entry[28], names + name_offset);
+				return -1;
+		}
+
+		// Lookups probe with hashName, so an entry stored under any other hash could never be found
+		const char *name = names + name_offset;
+		size_t name_len  = std::strlen(name);
+		uint32_t hash    = hashName(name, name_len);
+		if (hash != readLE32(entry)) {
+			sendToLog(LogLevel::Error, "%s has a wrong hash for %s\n", ai->file_name, name);
+			return -1;
+		}
+		uint32_t name_ref = internName(name, name_len, hash);
+		ai->files.add(name_ref, readLE64(entry + 8) + offset, readLE32(entry + 16), readLE32(entry + 20), compression_type);
+		ai->checksums.emplace_back(readLE32(entry + 24));
+	}
+
+	mapArchive(ai);
+
+	return 0;
+}
+
+void SarReader::mapArchive(ArchiveInfo *ai) {
+#ifdef LINUX
+	// Map the whole archive read-only, so that entries could be accessed without copying.
+	// Failure is not fatal (e.g. address space exhaustion on 32-bit systems), stdio is used then.
+	struct stat st;
+	if (fstat(fileno(ai->file_handle), &st) || st.st_size <= 0)
+		return;
+
+	void *ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fileno(ai->file_handle), 0);
+	if (ptr == MAP_FAILED) {
+		sendToLog(LogLevel::Warn, "Failed to map %s, falling back to buffered reads\n", ai->file_name);
+		return;
+	}
+
+	ai->mapping        = static_cast<uint8_t *>(ptr);
+	ai->mapping_length = static_cast<size_t>(st.st_size);
+#else
+	(void)ai;
+#endif
+}
+
 int SarReader::close() {
 	ArchiveInfo *info = archive_info.next;
 
@@ -146,6 +333,7 @@ int SarReader::close() {
 		delete last_archive_info;
 	}
 	num_of_sar_archives = 0;
+	clearFileIndex();
 
 	return 0;
 }
@@ -159,66 +347,606 @@ size_t SarReader::getNumFiles() {
 	size_t num        = 0;
 
 	for (size_t i = 0; i < num_of_sar_archives; i++) {
-		num += info->num_of_files;
+		num += info->files.size();
 		info = info->next;
 	}
 
 	return num;
 }
 
-size_t SarReader::getIndexFromFile(ArchiveInfo *ai, const char *file_name) {
+SarReader::NameSlot &SarReader::probeName(const char *name, size_t len, uint32_t hash) {
+	// The table is never more than half full, so there always is an empty slot to stop at
+	size_t mask = name_table.size() - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		auto &slot = name_table[i];
+		if (slot.name == NO_NAME)
+			return slot;
+		if (slot.hash == hash && slot.len == len && !std::memcmp(&name_pool[slot.name], name, len))
+			return slot;
+	}
+}
 
-	char *name_copy = copystr(file_name);
+uint32_t SarReader::internName(const char *name, size_t len) {
+	return internName(name, len, hashName(name, len));
+}
 
-	for (size_t i = 0; name_copy[i]; i++) {
-		if ('a' <= name_copy[i] && name_copy[i] <= 'z')
-			name_copy[i] += 'A' - 'a';
-		else if (name_copy[i] == '/')
-			name_copy[i] = '\\';
+uint32_t SarReader::internName(const char *name, size_t len, uint32_t hash) {
+	if ((num_of_names + 1) * 2 > name_table.size()) {
+		std::vector<NameSlot> old_table(std::max<size_t>(name_table.size() * 2, 1024));
+		name_table.swap(old_table);
+		size_t mask = name_table.size() - 1;
+		for (auto &old_slot : old_table) {
+			if (old_slot.name == NO_NAME)
+				continue;
+			size_t i = old_slot.hash & mask;
+			while (name_table[i].name != NO_NAME) i = (i + 1) & mask;
+			name_table[i] = old_slot;
+		}
 	}
 
-	size_t i;
-	for (i = 0; i < ai->num_of_files; i++) {
-		if (equalstr(name_copy, ai->fi_list[i].name))
-			break;
+	auto &slot = probeName(name, len, hash);
+	if (slot.name == NO_NAME) {
+		slot.hash = hash;
+		slot.name = static_cast<uint32_t>(name_pool.size());
+		slot.len  = static_cast<uint32_t>(len);
+		name_pool.insert(name_pool.end(), name, name + len);
+		name_pool.emplace_back('\0');
+		num_of_names++;
 	}
 
-	freearr(&name_copy);
+	return slot.name;
+}
 
-	return i;
+void SarReader::indexArchive(ArchiveInfo *ai) {
+	// Names were interned upper-cased by readArchive, earlier indexed entries are kept on duplicates
+	for (size_t i = 0; i < ai->files.size(); i++) {
+		const char *name = &name_pool[ai->files.names[i]];
+		size_t len       = std::strlen(name);
+		auto &slot       = probeName(name, len, hashName(name, len));
+		if (!slot.ai) {
+			slot.ai    = ai;
+			slot.index = static_cast<uint32_t>(i);
+		}
+	}
 }
 
-bool SarReader::getFileSub(ArchiveInfo *ai, const char *file_name, size_t &len, uint8_t **buffer) {
-	size_t i = getIndexFromFile(ai, file_name);
-	if (i == ai->num_of_files)
+void SarReader::clearFileIndex() {
+	for (auto &slot : name_table) slot.ai = nullptr;
+}
+
+bool SarReader::findFileEntry(const char *file_name, FileIndexEntry &entry) {
+	std::string name(file_name);
+
+	for (auto &ch : name) {
+		if ('a' <= ch && ch <= 'z')
+			ch += 'A' - 'a';
+		else if (ch == '/')
+			ch = '\\';
+	}
+
+	if (name_table.empty())
 		return false;
 
-	len = ai->fi_list[i].length;
+	auto &slot = probeName(name.data(), name.size(), hashName(name.data(), name.size()));
+	if (!slot.ai)
+		return false;
 
-	if (len > 0 && buffer) {
-		*buffer = new uint8_t[len + 1];
+	entry.ai    = slot.ai;
+	entry.index = slot.index;
+	return true;
+}
 
-		FileIO::seekFile(ai->file_handle, ai->fi_list[i].offset, SEEK_SET);
-		if (std::fread(*buffer, len, 1, ai->file_handle) != 1)
-			throw std::runtime_error("Error reading file");
+// Compressed entries are decoded sequentially, fetching the compressed data in chunks
+class SarReader::EntryDecoder {
+public:
+	EntryDecoder(ArchiveInfo *a, size_t off, size_t len)
+	    : ai(a), offset(off), end(off + len) {}
+	EntryDecoder(const EntryDecoder &) = delete;
+	EntryDecoder &operator=(const EntryDecoder &) = delete;
+	virtual ~EntryDecoder()                       = default;
+
+	// Decodes up to len bytes, returns less only when the data is over
+	virtual size_t decode(uint8_t *buffer, size_t len) = 0;
+
+protected:
+	ArchiveInfo *ai;
+	size_t offset, end;
+	std::array<uint8_t, 16 * 1024> input;
+	size_t input_pos{0}, input_len{0};
+	uint8_t bit_buffer{0}, bit_mask{0};
+
+	bool fillInput() {
+		if (offset >= end)
+			return false;
+		input_len = std::min(input.size(), end - offset);
+		input_pos = 0;
+		readArchiveData(ai, offset, input.data(), input_len);
+		offset += input_len;
+		return true;
 	}
 
+	// Reads n bits starting from the most significant one, returns -1 at the end of data
+	int readBits(int n) {
+		int x = 0;
+		for (int i = 0; i < n; i++) {
+			if (bit_mask == 0) {
+				if (input_pos == input_len && !fillInput())
+					return -1;
+				bit_buffer = input[input_pos++];
+				bit_mask   = 0x80;
+			}
+			x <<= 1;
+			if (bit_buffer & bit_mask)
+				x++;
+			bit_mask >>= 1;
+		}
+		return x;
+	}
+};
+
+class SarReader::LZSSDecoder : public EntryDecoder {
+public:
+	LZSSDecoder(ArchiveInfo *a, size_t off, size_t len, size_t original_len)
+	    : EntryDecoder(a, off, len), remaining(original_len) {}
+
+	size_t decode(uint8_t *buffer, size_t len) override {
+		size_t count = 0;
+		while (count < len && remaining > 0) {
+			if (copy_left == 0) {
+				int flag = readBits(1);
+				if (flag < 0)
+					break;
+				if (flag) {
+					int c = readBits(8);
+					if (c < 0)
+						break;
+					put(buffer[count++], static_cast<uint8_t>(c));
+					continue;
+				}
+				int i = readBits(WindowBits);
+				int j = readBits(LengthBits);
+				if (i < 0 || j < 0)
+					break;
+				copy_pos  = static_cast<size_t>(i);
+				copy_left = static_cast<size_t>(j) + 2;
+			}
+			put(buffer[count++], window[copy_pos++ & (WindowSize - 1)]);
+			copy_left--;
+		}
+		return count;
+	}
+
+private:
+	static constexpr int WindowBits    = 8;
+	static constexpr int LengthBits    = 4;
+	static constexpr size_t WindowSize = 1 << WindowBits;
+
+	std::array<uint8_t, WindowSize> window{};
+	size_t window_pos{WindowSize - (1 << LengthBits) - 1};
+	size_t copy_pos{0}, copy_left{0};
+	size_t remaining;
+
+	void put(uint8_t &dst, uint8_t c) {
+		dst                                     = c;
+		window[window_pos++ & (WindowSize - 1)] = c;
+		remaining--;
+	}
+};
+
+// SPB images are stored as bottom-up colour planes, they are decoded at once into a 24-bit BMP
+class SarReader::SPBDecoder : public EntryDecoder {
+public:
+	static size_t decodedLength(size_t width, size_t height) {
+		return (width * 3 + padding(width)) * height + HeaderSize;
+	}
+
+	SPBDecoder(ArchiveInfo *a, size_t off, size_t len)
+	    : EntryDecoder(a, off, len) {
+		int width_bits  = readBits(16);
+		int height_bits = readBits(16);
+		if (width_bits < 0 || height_bits < 0)
+			return;
+
+		size_t width  = static_cast<size_t>(width_bits);
+		size_t height = static_cast<size_t>(height_bits);
+		size_t stride = width * 3 + padding(width);
+		size_t total  = decodedLength(width, height);
+
+		image.resize(total);
+		uint8_t *buf = image.data();
+		writeLE(buf + 2, total, 4);
+		buf[0]  = 'B';
+		buf[1]  = 'M';
+		buf[10] = HeaderSize; // offset to the body
+		buf[14] = 40;         // info header size
+		writeLE(buf + 18, width, 4);
+		writeLE(buf + 22, height, 4);
+		buf[26] = 1;  // planes
+		buf[28] = 24; // bpp
+		writeLE(buf + 34, total - HeaderSize, 4);
+
+		if (width == 0 || height == 0)
+			return;
+
+		buf += HeaderSize;
+		// Runs are decoded by four, allow them to overshoot
+		std::vector<uint8_t> plane(width * height + 4);
+		for (size_t i = 0; i < 3; i++) {
+			size_t count = 0;
+			int c        = readBits(8);
+			if (c < 0)
+				break;
+			plane[count++] = static_cast<uint8_t>(c);
+			while (count < width * height) {
+				int n = readBits(3);
+				if (n < 0)
+					break;
+				if (n == 0) {
+					for (size_t j = 0; j < 4; j++) plane[count++] = static_cast<uint8_t>(c);
+					continue;
+				}
+				int m = n == 7 ? readBits(1) + 1 : n + 2;
+				for (size_t j = 0; j < 4; j++) {
+					if (m == 8) {
+						c = readBits(8);
+					} else {
+						int k = readBits(m);
+						if (k & 1)
+							c += (k >> 1) + 1;
+						else
+							c -= (k >> 1);
+					}
+					plane[count++] = static_cast<uint8_t>(c);
+				}
+			}
+
+			// Rows go bottom-up in a zigzag order
+			uint8_t *pbuf        = buf + stride * (height - 1) + i;
+			const uint8_t *psbuf = plane.data();
+			for (size_t j = 0; j < height; j++) {
+				if (j & 1) {
+					for (size_t k = 0; k < width; k++, pbuf -= 3) *pbuf = *psbuf++;
+					pbuf -= stride - 3;
+				} else {
+					for (size_t k = 0; k < width; k++, pbuf += 3) *pbuf = *psbuf++;
+					pbuf -= stride + 3;
+				}
+			}
+		}
+	}
+
+	size_t decode(uint8_t *buffer, size_t len) override {
+		len = std::min(len, image.size() - image_pos);
+		std::memcpy(buffer, image.data() + image_pos, len);
+		image_pos += len;
+		return len;
+	}
+
+private:
+	static constexpr size_t HeaderSize = 54;
+
+	std::vector<uint8_t> image;
+	size_t image_pos{0};
+
+	static size_t padding(size_t width) {
+		return (4 - width * 3 % 4) % 4;
+	}
+	static void writeLE(uint8_t *dst, size_t value, size_t bytes) {
+		for (size_t i = 0; i < bytes; i++) dst[i] = static_cast<uint8_t>(value >> (i * 8));
+	}
+};
+
+// NBZ entries are the original length (4 bytes, big endian) followed by one or more bzip2 streams
+class SarReader::NBZDecoder : public EntryDecoder {
+public:
+	NBZDecoder(ArchiveInfo *a, size_t off, size_t len, size_t original_len)
+	    : EntryDecoder(a, off + 4, len > 4 ? len - 4 : 0), remaining(original_len) {
+		initialised = BZ2_bzDecompressInit(&stream, 0, 0) == BZ_OK;
+	}
+	~NBZDecoder() override {
+		if (initialised)
+			BZ2_bzDecompressEnd(&stream);
+	}
+
+	size_t decode(uint8_t *buffer, size_t len) override {
+		if (!initialised)
+			return 0;
+
+		len              = std::min(len, remaining);
+		stream.next_out  = reinterpret_cast<char *>(buffer);
+		stream.avail_out = static_cast<unsigned int>(len);
+
+		while (stream.avail_out > 0) {
+			if (stream.avail_in == 0) {
+				if (!fillInput())
+					break;
+				stream.next_in  = reinterpret_cast<char *>(input.data());
+				stream.avail_in = static_cast<unsigned int>(input_len);
+			}
+
+			int err = BZ2_bzDecompress(&stream);
+			if (err == BZ_STREAM_END) {
+				// Restart on the data following the finished stream
+				char *next_in      = stream.next_in;
+				unsigned avail_in  = stream.avail_in;
+				char *next_out     = stream.next_out;
+				unsigned avail_out = stream.avail_out;
+				BZ2_bzDecompressEnd(&stream);
+				stream      = bz_stream{};
+				initialised = BZ2_bzDecompressInit(&stream, 0, 0) == BZ_OK;
+				if (!initialised)
+					break;
+				stream.next_in   = next_in;
+				stream.avail_in  = avail_in;
+				stream.next_out  = next_out;
+				stream.avail_out = avail_out;
+			} else if (err != BZ_OK) {
+				break;
+			}
+		}
+
+		size_t count = len - stream.avail_out;
+		remaining -= count;
+		return count;
+	}
+
+private:
+	bz_stream stream{};
+	bool initialised{false};
+	size_t remaining;
+};
+
+class SarReader::ZLIBDecoder : public EntryDecoder {
+public:
+	ZLIBDecoder(ArchiveInfo *a, size_t off, size_t len, size_t original_len)
+	    : EntryDecoder(a, off, len), remaining(original_len) {
+		initialised = inflateInit(&stream) == Z_OK;
+	}
+	~ZLIBDecoder() override {
+		if (initialised)
+			inflateEnd(&stream);
+	}
+
+	size_t decode(uint8_t *buffer, size_t len) override {
+		if (!initialised)
+			return 0;
+
+		len              = std::min(len, remaining);
+		stream.next_out  = buffer;
+		stream.avail_out = static_cast<uInt>(len);
+
+		while (stream.avail_out > 0) {
+			if (stream.avail_in == 0) {
+				if (!fillInput())
+					break;
+				stream.next_in  = input.data();
+				stream.avail_in = static_cast<uInt>(input_len);
+			}
+
+			int err = inflate(&stream, Z_NO_FLUSH);
+			if (err != Z_OK)
+				break;
+		}
+
+		size_t count = len - stream.avail_out;
+		remaining -= count;
+		return count;
+	}
+
+private:
+	z_stream stream{};
+	bool initialised{false};
+	size_t remaining;
+};
+
+size_t SarReader::getDecodedLength(ArchiveInfo *ai, size_t index) {
+	auto &files = ai->files;
+	uint8_t prefix[4];
+
+	switch (files.compression_types[index]) {
+		case LZSS_COMPRESSION:
+		case ZLIB_COMPRESSION:
+			return files.original_lengths[index];
+		case NBZ_COMPRESSION:
+			if (files.lengths[index] < sizeof(prefix))
+				return 0;
+			readArchiveData(ai, files.offsets[index], prefix, sizeof(prefix));
+			return readBE32(prefix);
+		case SPB_COMPRESSION:
+			if (files.lengths[index] < sizeof(prefix))
+				return 0;
+			readArchiveData(ai, files.offsets[index], prefix, sizeof(prefix));
+			return SPBDecoder::decodedLength(readBE16(prefix), readBE16(prefix + 2));
+		default:
+			return files.lengths[index];
+	}
+}
+
+std::unique_ptr<SarReader::EntryDecoder> SarReader::createDecoder(ArchiveInfo *ai, size_t index) {
+	auto &files   = ai->files;
+	size_t offset = files.offsets[index];
+	size_t length = files.lengths[index];
+
+	switch (files.compression_types[index]) {
+		case LZSS_COMPRESSION:
+			return std::make_unique<LZSSDecoder>(ai, offset, length, files.original_lengths[index]);
+		case NBZ_COMPRESSION:
+			return std::make_unique<NBZDecoder>(ai, offset, length, getDecodedLength(ai, index));
+		case SPB_COMPRESSION:
+			return std::make_unique<SPBDecoder>(ai, offset, length);
+		case ZLIB_COMPRESSION:
+			return std::make_unique<ZLIBDecoder>(ai, offset, length, files.original_lengths[index]);
+		default:
+			return nullptr;
+	}
+}
+
+bool SarReader::getFileSub(ArchiveInfo *ai, size_t index, size_t &len, uint8_t **buffer) {
+	bool compressed = ai->files.compression_types[index] != NO_COMPRESSION;
+	len             = compressed ? getDecodedLength(ai, index) : ai->files.lengths[index];
+
+	if (len == 0 || !buffer)
+		return true;
+
+	*buffer = new uint8_t[len + 1];
+	if (compressed) {
+		auto decoder = createDecoder(ai, index);
+		size_t rd    = decoder->decode(*buffer, len);
+		if (rd != len) {
+			sendToLog(LogLevel::Error, "Entry %s is truncated, decoded %zu bytes out of %zu\n",
+			          &name_pool[ai->files.names[index]], rd, len);
+			std::memset(*buffer + rd, 0, len - rd);
+		}
+		(*buffer)[len] = 0x00;
+	} else {
+		readArchiveData(ai, ai->files.offsets[index], *buffer, len);
+	}
+
+	if (!ai->checksums.empty() && crc32(0, *buffer, static_cast<uInt>(len)) != ai->checksums[index])
+		sendToLog(LogLevel::Error, "Entry %s is damaged, checksum mismatch\n", &name_pool[ai->files.names[index]]);
+
 	return true;
 }
 
+void SarReader::readArchiveData(ArchiveInfo *ai, size_t offset, uint8_t *buffer, size_t len) {
+	// Must be safe to call from several threads at once, thus no shared file position is used
+	if (ai->mapping) {
+		if (offset + len > ai->mapping_length)
+			throw std::runtime_error("Error reading file");
+		std::memcpy(buffer, ai->mapping + offset, len);
+		return;
+	}
+
+#ifdef WIN32
+	// There are no positional reads in stdio, serialise seek and read per archive
+	Lock lock(ai);
+	FileIO::seekFile(ai->file_handle, offset, SEEK_SET);
+	if (std::fread(buffer, len, 1, ai->file_handle) != 1)
+		throw std::runtime_error("Error reading file");
+#else
+	int fd = fileno(ai->file_handle);
+	while (len > 0) {
+		ssize_t rd = pread(fd, buffer, len, static_cast<off_t>(offset));
+		if (rd < 0 && errno == EINTR)
+			continue;
+		if (rd <= 0)
+			throw std::runtime_error("Error reading file");
+		buffer += rd;
+		offset += static_cast<size_t>(rd);
+		len -= static_cast<size_t>(rd);
+	}
+#endif
+}
+
 bool SarReader::getFile(const char *file_name, size_t &len, uint8_t **buffer) {
 	if (DirectReader::getFile(file_name, len, buffer))
 		return true;
 
-	ArchiveInfo *info = archive_info.next;
+	FileIndexEntry entry;
+	if (findFileEntry(file_name, entry))
+		return getFileSub(entry.ai, entry.index, len, buffer);
 
-	for (size_t i = 0; i < num_of_sar_archives; i++) {
-		if (getFileSub(info, file_name, len, buffer))
-			return true;
-		info = info->next;
+	return false;
+}
+
+bool SarReader::getFileView(const char *file_name, size_t &len, const uint8_t **buffer) {
+	// Loose files override archive contents and are never mapped
+	size_t direct_len;
+	if (DirectReader::getFile(file_name, direct_len, nullptr))
+		return false;
+
+	FileIndexEntry entry;
+	if (!findFileEntry(file_name, entry) || !entry.ai->mapping ||
+	    entry.ai->files.compression_types[entry.index] != NO_COMPRESSION)
+		return false;
+
+	size_t offset = entry.ai->files.offsets[entry.index];
+	size_t length = entry.ai->files.lengths[entry.index];
+	if (offset + length > entry.ai->mapping_length)
+		return false;
+
+	len     = length;
+	*buffer = entry.ai->mapping + offset;
+
+	return true;
+}
+
+// Streams an archive entry through positional reads shared with the other readers of the archive
+class SarReader::ArchiveStream : public Stream {
+public:
+	ArchiveStream(ArchiveInfo *a, size_t off, size_t len)
+	    : Stream(len), ai(a), offset(off) {}
+
+protected:
+	size_t readAt(size_t pos, uint8_t *buffer, size_t len) override {
+		try {
+			readArchiveData(ai, offset + pos, buffer, len);
+		} catch (std::runtime_error &) {
+			return 0;
+		}
+		return len;
 	}
 
-	return false;
+private:
+	ArchiveInfo *ai;
+	size_t offset;
+};
+
+// Streams a compressed archive entry, seeking backwards restarts the decoding
+class SarReader::DecoderStream : public Stream {
+public:
+	DecoderStream(SarReader *r, ArchiveInfo *a, size_t i, size_t len)
+	    : Stream(len), reader(r), ai(a), index(i), decoder(r->createDecoder(a, i)) {}
+
+protected:
+	size_t readAt(size_t pos, uint8_t *buffer, size_t len) override {
+		try {
+			if (pos < decoded) {
+				decoder = reader->createDecoder(ai, index);
+				decoded = 0;
+			}
+			while (decoded < pos) {
+				uint8_t skip[4096];
+				size_t rd = decoder->decode(skip, std::min(sizeof(skip), pos - decoded));
+				if (rd == 0)
+					return 0;
+				decoded += rd;
+			}
+			size_t rd = decoder->decode(buffer, len);
+			decoded += rd;
+			return rd;
+		} catch (std::runtime_error &) {
+			return 0;
+		}
+	}
+
+private:
+	SarReader *reader;
+	ArchiveInfo *ai;
+	size_t index;
+	std::unique_ptr<EntryDecoder> decoder;
+	size_t decoded{0};
+};
+
+std::unique_ptr<BaseReader::Stream> SarReader::openStream(const char *file_name) {
+	auto stream = DirectReader::openStream(file_name);
+	if (stream)
+		return stream;
+
+	FileIndexEntry entry;
+	if (!findFileEntry(file_name, entry))
+		return nullptr;
+
+	if (entry.ai->files.compression_types[entry.index] != NO_COMPRESSION) {
+		try {
+			size_t len = getDecodedLength(entry.ai, entry.index);
+			return std::make_unique<DecoderStream>(this, entry.ai, entry.index, len);
+		} catch (std::runtime_error &) {
+			return nullptr;
+		}
+	}
+
+	return std::make_unique<ArchiveStream>(entry.ai, entry.ai->files.offsets[entry.index], entry.ai->files.lengths[entry.index]);
 }
 
 bool SarReader::getFile(const char *file_name, size_t &len, std::vector<uint8_t> &buffer) {
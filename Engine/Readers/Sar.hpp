@@ -12,6 +12,9 @@
 #include "External/Compatibility.hpp"
 #include "Engine/Readers/Direct.hpp"
 
+#include <string>
+#include <vector>
+
 class SarReader : public DirectReader {
 public:
 	SarReader(DirPaths &path);
@@ -24,15 +27,54 @@ public:
 
 	bool getFile(const char *file_name, size_t &len, uint8_t **buffer = nullptr) override;
 	bool getFile(const char *file_name, size_t &len, std::vector<uint8_t> &buffer) override;
+	bool getFileView(const char *file_name, size_t &len, const uint8_t **buffer) override;
+	std::unique_ptr<Stream> openStream(const char *file_name) override;
 
 protected:
+	class ArchiveStream;
+	class DecoderStream;
+	class EntryDecoder;
+	class LZSSDecoder;
+	class SPBDecoder;
+	class NBZDecoder;
+	class ZLIBDecoder;
+
 	ArchiveInfo archive_info;
 	ArchiveInfo *root_archive_info, *last_archive_info;
 	size_t num_of_sar_archives;
 
+	struct FileIndexEntry {
+		ArchiveInfo *ai;
+		size_t index;
+	};
+
+	static constexpr uint32_t NO_NAME{UINT32_MAX};
+	struct NameSlot {
+		uint32_t hash{0};
+		uint32_t name{NO_NAME};
+		uint32_t len{0}; // compared before the name, so that the pool is never read past its end
+		ArchiveInfo *ai{nullptr}; // entry this name resolves to, the one indexed first wins
+		uint32_t index{0};
+	};
+	// Interned upper-case entry names of all archives, null-terminated and stored back to back
+	std::vector<char> name_pool;
+	// Open addressing table over name_pool, doubles as the file index
+	std::vector<NameSlot> name_table;
+	size_t num_of_names{0};
+
 	int readArchive(ArchiveInfo *ai, int archive_type = ARCHIVE_TYPE_SAR, size_t offset = 0);
-	size_t getIndexFromFile(ArchiveInfo *ai, const char *file_name);
-	bool getFileSub(ArchiveInfo *ai, const char *file_name, size_t &len, uint8_t **buffer);
+	int readIndexedArchive(ArchiveInfo *ai, size_t offset);
+	void mapArchive(ArchiveInfo *ai);
+	uint32_t internName(const char *name, size_t len);
+	uint32_t internName(const char *name, size_t len, uint32_t hash);
+	NameSlot &probeName(const char *name, size_t len, uint32_t hash);
+	void indexArchive(ArchiveInfo *ai);
+	void clearFileIndex();
+	bool findFileEntry(const char *file_name, FileIndexEntry &entry);
+	bool getFileSub(ArchiveInfo *ai, size_t index, size_t &len, uint8_t **buffer);
+	static void readArchiveData(ArchiveInfo *ai, size_t offset, uint8_t *buffer, size_t len);
+	size_t getDecodedLength(ArchiveInfo *ai, size_t index);
+	std::unique_ptr<EntryDecoder> createDecoder(ArchiveInfo *ai, size_t index);
 
 	bool updateVector(std::vector<uint8_t> &buffer, uint8_t *tmp, size_t len);
 };
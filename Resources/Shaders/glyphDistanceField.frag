@@ -0,0 +1,20 @@
+#version 120
+uniform vec4 glyphColor;
+uniform float smoothing;
+uniform float outline;
+uniform sampler2D tex;
+
+varying vec4 color;
+varying /* PRAGMA: ONS_RU highprecision */ vec2 texCoord;
+
+void main(void) {
+	// 0.5 lies on the glyph outline, larger values are inside
+	float distance = texture2D(tex, texCoord.st).a;
+	float alpha;
+	if (outline > 0.0)
+		alpha = 1.0 - smoothstep(outline - smoothing, outline + smoothing, abs(distance - 0.5));
+	else
+		alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+
+	gl_FragColor = vec4(glyphColor.rgb * alpha, alpha) * color.a;
+}
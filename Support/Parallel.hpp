@@ -0,0 +1,76 @@
+/**
+ *  Parallel.hpp
+ *  ONScripter-RU
+ *
+ *  Contains code to split independent jobs between worker threads.
+ *
+ *  Consult LICENSE file for licensing terms and copyright holders.
+ */
+
+#pragma once
+
+#include "External/Compatibility.hpp"
+
+#include <SDL2/SDL_cpuinfo.h>
+#include <SDL2/SDL_thread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// Threads worth using for a CPU bound job, the calling one included
+inline size_t parallelThreadCount(size_t max = 8) {
+	return std::min<size_t>(std::max(SDL_GetCPUCount(), 1), max);
+}
+
+// Hands job(0) to job(count - 1) out to worker threads without blocking the caller.
+// Cancellation is up to the job itself: check the condition inside and return early.
+class ParallelJobs {
+	std::function<void(size_t)> job;
+	size_t count;
+	std::atomic<size_t> next{0};
+	std::vector<SDL_Thread *> workers;
+
+	static int workerLoop(void *jobs) {
+		static_cast<ParallelJobs *>(jobs)->help();
+		return 0;
+	}
+
+public:
+	ParallelJobs(size_t _count, std::function<void(size_t)> _job, const char *name, size_t threads)
+	    : job(std::move(_job)), count(_count) {
+		for (size_t i = 0; i < threads && i < count; i++) {
+			auto thread = SDL_CreateThread(workerLoop, name, this);
+			if (!thread)
+				break;
+			workers.emplace_back(thread);
+		}
+	}
+	ParallelJobs(const ParallelJobs &) = delete;
+	ParallelJobs &operator=(const ParallelJobs &) = delete;
+	~ParallelJobs() {
+		join();
+	}
+
+	size_t threadCount() const {
+		return workers.size();
+	}
+	// Makes the calling thread run the remaining jobs alongside the workers
+	void help() {
+		size_t i;
+		while ((i = next.fetch_add(1, std::memory_order_relaxed)) < count) job(i);
+	}
+	void join() {
+		for (auto thread : workers) SDL_WaitThread(thread, nullptr);
+		workers.clear();
+	}
+};
+
+// Runs job(0) to job(count - 1) on up to maxThreads threads, the calling one included
+template <typename F>
+void runParallel(size_t count, F &&job, const char *name = "ParallelJobs", size_t maxThreads = 8) {
+	ParallelJobs jobs(count, std::forward<F>(job), name, parallelThreadCount(maxThreads) - 1);
+	jobs.help();
+	jobs.join();
+}
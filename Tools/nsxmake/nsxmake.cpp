@@ -0,0 +1,304 @@
+/**
+ *  nsxmake.cpp
+ *  ONScripter-RU
+ *
+ *  Indexed archive creation tool.
+ *
+ *  Consult LICENSE file for licensing terms and copyright holders.
+ */
+
+#include <zlib.h>
+
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define DEF_OUT "00.nsx"
+#define DEF_ALIGNMENT 16
+#define HEADER_SIZE 32
+#define ENTRY_SIZE 32
+#define MAX_ENTRY_SIZE 0xFFFFFFFFUL
+
+// Archive layout is documented in Engine/Readers/Sar.cpp (SarReader::readIndexedArchive)
+
+enum {
+	STORE   = 0,
+	DEFLATE = 1
+};
+
+struct Entry {
+	std::string path; // path on disk
+	std::string name; // upper-case name with backslashes as looked up by the engine
+	uint32_t hash;
+	uint64_t offset;
+	uint32_t stored_length;
+	uint32_t original_length;
+	uint32_t checksum;
+	uint8_t compression;
+};
+
+// Formats that are compressed already and are not worth deflating
+static const char *stored_exts[] = {"png", "jpg", "jpeg", "webp", "ogg", "mp3", "opus", "webm", "mp4", "mkv", "ttf", "otf", "zip"};
+
+static uint32_t hashName(const std::string &name) {
+	// FNV-1a, same as in the engine
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < name.size(); i++) {
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static void putLE32(unsigned char *buf, uint32_t value) {
+	for (int i = 0; i < 4; i++) buf[i] = (unsigned char)(value >> (i * 8));
+}
+
+static void putLE64(unsigned char *buf, uint64_t value) {
+	putLE32(buf, (uint32_t)value);
+	putLE32(buf + 4, (uint32_t)(value >> 32));
+}
+
+static bool isStored(const std::string &name) {
+	size_t dot = name.rfind('.');
+	if (dot == std::string::npos)
+		return false;
+	std::string ext = name.substr(dot + 1);
+	for (size_t i = 0; i < ext.size(); i++) ext[i] = tolower((unsigned char)ext[i]);
+	for (size_t i = 0; i < sizeof(stored_exts) / sizeof(*stored_exts); i++) {
+		if (ext == stored_exts[i])
+			return true;
+	}
+	return false;
+}
+
+static bool collectFiles(const std::string &dir, const std::string &prefix, std::vector<Entry> &entries) {
+	DIR *dp = opendir(dir.c_str());
+	if (!dp) {
+		fprintf(stderr, "Couldn't open directory '%s'\n", dir.c_str());
+		return false;
+	}
+
+	struct dirent *ent;
+	while ((ent = readdir(dp))) {
+		if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, ".."))
+			continue;
+
+		std::string path = dir + "/" + ent->d_name;
+		std::string name = prefix + ent->d_name;
+
+		struct stat st;
+		if (stat(path.c_str(), &st)) {
+			fprintf(stderr, "Couldn't stat '%s'\n", path.c_str());
+			closedir(dp);
+			return false;
+		}
+
+		if (S_ISDIR(st.st_mode)) {
+			if (!collectFiles(path, name + "\\", entries)) {
+				closedir(dp);
+				return false;
+			}
+		} else if (S_ISREG(st.st_mode)) {
+			if ((uint64_t)st.st_size > MAX_ENTRY_SIZE) {
+				fprintf(stderr, "'%s' is too big\n", path.c_str());
+				closedir(dp);
+				return false;
+			}
+			Entry entry{};
+			entry.path = path;
+			for (size_t i = 0; i < name.size(); i++) {
+				char c = name[i];
+				if (c == '/')
+					c = '\\';
+				else if ('a' <= c && c <= 'z')
+					c += 'A' - 'a';
+				entry.name += c;
+			}
+			entry.hash = hashName(entry.name);
+			entries.push_back(entry);
+		}
+	}
+
+	closedir(dp);
+	return true;
+}
+
+static bool writeZeroes(FILE *fp, uint64_t len) {
+	static const unsigned char zeroes[4096] = {};
+	while (len > 0) {
+		size_t cur = len < sizeof(zeroes) ? (size_t)len : sizeof(zeroes);
+		if (fwrite(zeroes, cur, 1, fp) != 1)
+			return false;
+		len -= cur;
+	}
+	return true;
+}
+
+static bool readWhole(const char *path, std::vector<unsigned char> &data) {
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+
+	data.clear();
+	unsigned char buf[0x10000];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) data.insert(data.end(), buf, buf + len);
+
+	bool ok = !ferror(fp);
+	fclose(fp);
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	const char *out_filename = DEF_OUT, *in_dir = NULL;
+	unsigned long alignment = DEF_ALIGNMENT;
+	int level               = Z_BEST_COMPRESSION;
+	bool store_all          = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			out_filename = argv[++i];
+		} else if (!strcmp(argv[i], "-a") && i + 1 < argc) {
+			alignment = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+			level = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-s")) {
+			store_all = true;
+		} else if (!in_dir && argv[i][0] != '-') {
+			in_dir = argv[i];
+		} else {
+			in_dir = NULL;
+			break;
+		}
+	}
+
+	if (!in_dir || alignment == 0 || (alignment & (alignment - 1)) || level < 0 || level > 9) {
+		fprintf(stderr, "Usage: nsxmake [-o nsx_file] [-a alignment] [-l level] [-s] in_dir\n");
+		fprintf(stderr, "	(nsx_file defaults to \"" DEF_OUT "\", alignment to %d, level to %d)\n", DEF_ALIGNMENT, Z_BEST_COMPRESSION);
+		fprintf(stderr, "	-s stores all the files without compression\n");
+		return 1;
+	}
+
+	std::vector<Entry> entries;
+	if (!collectFiles(in_dir, "", entries))
+		return 1;
+
+	std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+		return a.name < b.name;
+	});
+
+	for (size_t i = 1; i < entries.size(); i++) {
+		if (entries[i].name == entries[i - 1].name) {
+			fprintf(stderr, "'%s' and '%s' differ only in case\n", entries[i - 1].path.c_str(), entries[i].path.c_str());
+			return 1;
+		}
+	}
+
+	// Table of contents goes first, so that it is read at once on opening
+	std::vector<unsigned char> names;
+	std::vector<uint32_t> name_offsets;
+	for (size_t i = 0; i < entries.size(); i++) {
+		name_offsets.push_back((uint32_t)names.size());
+		names.insert(names.end(), entries[i].name.begin(), entries[i].name.end());
+		names.push_back('\0');
+	}
+
+	size_t toc_size = entries.size() * ENTRY_SIZE + names.size();
+	uint64_t offset = HEADER_SIZE + toc_size;
+
+	FILE *out_fp = fopen(out_filename, "wb");
+	if (!out_fp) {
+		fprintf(stderr, "Couldn't open '%s' for writing\n", out_filename);
+		return 1;
+	}
+
+	// Entry data is written first, the header and the table of contents are filled in afterwards
+	if (!writeZeroes(out_fp, offset)) {
+		fprintf(stderr, "Couldn't write to '%s'\n", out_filename);
+		fclose(out_fp);
+		return 1;
+	}
+
+	std::vector<unsigned char> data, packed;
+	for (size_t i = 0; i < entries.size(); i++) {
+		Entry &entry = entries[i];
+		if (!readWhole(entry.path.c_str(), data)) {
+			fprintf(stderr, "Couldn't read '%s'\n", entry.path.c_str());
+			fclose(out_fp);
+			return 1;
+		}
+
+		entry.original_length = (uint32_t)data.size();
+		entry.checksum        = (uint32_t)crc32(0, data.data(), (uInt)data.size());
+		entry.compression     = STORE;
+
+		const unsigned char *out_data = data.data();
+		size_t out_len                = data.size();
+
+		if (!store_all && !isStored(entry.name) && !data.empty()) {
+			uLongf packed_len = compressBound((uLong)data.size());
+			packed.resize(packed_len);
+			if (compress2(packed.data(), &packed_len, data.data(), (uLong)data.size(), level) != Z_OK) {
+				fprintf(stderr, "Compression error\n");
+				fclose(out_fp);
+				return 1;
+			}
+			// Only keep compressed data when it saves enough to pay for the decompression
+			if (packed_len < data.size() - data.size() / 10) {
+				entry.compression = DEFLATE;
+				out_data          = packed.data();
+				out_len           = packed_len;
+			}
+		}
+
+		entry.stored_length = (uint32_t)out_len;
+
+		uint64_t aligned = (offset + alignment - 1) & ~(uint64_t)(alignment - 1);
+		if (!writeZeroes(out_fp, aligned - offset) || (out_len > 0 && fwrite(out_data, out_len, 1, out_fp) != 1)) {
+			fprintf(stderr, "Couldn't write to '%s'\n", out_filename);
+			fclose(out_fp);
+			return 1;
+		}
+		entry.offset = aligned;
+		offset       = aligned + out_len;
+	}
+
+	std::vector<unsigned char> toc(toc_size);
+	for (size_t i = 0; i < entries.size(); i++) {
+		unsigned char *buf = &toc[i * ENTRY_SIZE];
+		putLE32(buf, entries[i].hash);
+		putLE32(buf + 4, name_offsets[i]);
+		putLE64(buf + 8, entries[i].offset);
+		putLE32(buf + 16, entries[i].stored_length);
+		putLE32(buf + 20, entries[i].original_length);
+		putLE32(buf + 24, entries[i].checksum);
+		buf[28] = entries[i].compression;
+	}
+	if (!names.empty())
+		memcpy(&toc[entries.size() * ENTRY_SIZE], names.data(), names.size());
+
+	unsigned char header[HEADER_SIZE] = {'N', 'S', 'X', 'A'};
+	putLE32(header + 4, 1); // version
+	putLE32(header + 8, (uint32_t)entries.size());
+	putLE32(header + 12, (uint32_t)names.size());
+	putLE32(header + 16, (uint32_t)alignment);
+	putLE32(header + 20, (uint32_t)crc32(0, toc.data(), (uInt)toc.size()));
+
+	fseek(out_fp, 0, SEEK_SET);
+	if (fwrite(header, HEADER_SIZE, 1, out_fp) != 1 || (toc_size > 0 && fwrite(toc.data(), toc_size, 1, out_fp) != 1)) {
+		fprintf(stderr, "Couldn't write to '%s'\n", out_filename);
+		fclose(out_fp);
+		return 1;
+	}
+
+	fclose(out_fp);
+	return 0;
+}